@@ -0,0 +1,369 @@
+/*
+ * animate.c - part of noisegen
+ *
+ * Make a sequence of frames of 2D or 3D noise that evolves smoothly in
+ * time. The shaped spectrum is made once; for every new frame each bin
+ * turns its phase by a rate that grows as sqrt(|k|), like deep-water
+ * waves, so small features change faster than large ones while the
+ * power spectrum stays exactly the same. Each frame then costs one
+ * pass over the spectrum and one inverse FFT, and a writer thread
+ * encodes frame k while frame k+1 is being made.
+ *
+ * link with -lfftw3f -lpthread
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "fft.h"
+#include "fftplan.h"
+#include "filter.h"
+#include "output2d.h"
+#include "output3d.h"
+#include "ensemble.h"
+#include "spectrum.h"
+#include "animate.h"
+
+
+//
+// Hands finished frames from the generator to the writer, one at a time
+//
+typedef struct frameWriterType {
+  uint8_t numDims;
+  size_t n[MAXDIMS];
+  OUTFF outtype;
+  const char* outfile;
+  // the frame being handed over, and its number
+  float* frame;
+  size_t index;
+  BOOL full;
+  BOOL done;
+  // set once any frame could not be written
+  BOOL failed;
+#ifndef _WIN32
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} FRAMEWRITER;
+
+//
+// Write frame number index to out_0000.png and so on, return 1 if it
+// could not be written
+//
+static int writeFrame (const FRAMEWRITER* w, float* frame, const size_t index) {
+
+  char name[255+16];
+  ensembleFileName(w->outfile, index, name);
+
+  if (w->numDims == 2) {
+    return writeData2D(w->outtype, name, frame, w->n[0], w->n[1]);
+  } else {
+    return writeData3D(w->outtype, name, frame, w->n[0], w->n[1], w->n[2]);
+  }
+}
+
+#ifndef _WIN32
+static void* writerLoop (void* arg) {
+
+  FRAMEWRITER* w = (FRAMEWRITER*)arg;
+  pthread_mutex_lock(&w->lock);
+  while (TRUE) {
+    while (!w->full && !w->done) pthread_cond_wait(&w->cond, &w->lock);
+    if (!w->full) break;
+
+    // write without holding the lock, so the next frame can be made
+    float* frame = w->frame;
+    const size_t index = w->index;
+    pthread_mutex_unlock(&w->lock);
+    const int failed = writeFrame(w, frame, index);
+    pthread_mutex_lock(&w->lock);
+
+    if (failed) w->failed = TRUE;
+    w->full = FALSE;
+    pthread_cond_broadcast(&w->cond);
+  }
+  pthread_mutex_unlock(&w->lock);
+  return NULL;
+}
+#endif
+
+static void startWriter (FRAMEWRITER* w) {
+  w->full = FALSE;
+  w->done = FALSE;
+  w->failed = FALSE;
+#ifndef _WIN32
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->cond, NULL);
+  pthread_create(&w->thread, NULL, writerLoop, w);
+#endif
+}
+
+//
+// Hand over a finished frame once the writer is done with the one
+// before it; without threads, just write it; return 1 if any frame so
+// far could not be written, so that no more need be made
+//
+static int queueFrame (FRAMEWRITER* w, float* frame, const size_t index) {
+#ifndef _WIN32
+  pthread_mutex_lock(&w->lock);
+  while (w->full) pthread_cond_wait(&w->cond, &w->lock);
+  const BOOL failed = w->failed;
+  if (!failed) {
+    w->frame = frame;
+    w->index = index;
+    w->full = TRUE;
+    pthread_cond_broadcast(&w->cond);
+  }
+  pthread_mutex_unlock(&w->lock);
+  return failed ? 1 : 0;
+#else
+  if (writeFrame(w, frame, index)) w->failed = TRUE;
+  return w->failed ? 1 : 0;
+#endif
+}
+
+//
+// Wait for the last frame, and return 1 if any could not be written
+//
+static int endWriter (FRAMEWRITER* w) {
+#ifndef _WIN32
+  pthread_mutex_lock(&w->lock);
+  w->done = TRUE;
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+  pthread_join(w->thread, NULL);
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->cond);
+#endif
+  return w->failed ? 1 : 0;
+}
+
+
+//
+// +1 or -1 from the bin number and the seed
+//
+static float binDirection (const size_t bin, const int randSeed) {
+  uint64_t z = (uint64_t)bin + ((uint64_t)(uint32_t)randSeed << 32) + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z ^= z >> 31;
+  return (z >> 63) ? -1.0 : 1.0;
+}
+
+//
+// Squared distance of index i from 0 around a ring of n; unlike the
+// wavenumbers of the filters, i and n-i always match, even for odd n
+//
+static size_t ringSquare (const size_t i, const size_t n) {
+  const size_t k = (i <= n-i) ? i : n-i;
+  return k*k;
+}
+
+//
+// The per-frame phase turn of every stored bin; half of the waves go
+// each way, so the pattern does not drift, and a bin and its conjugate
+// mirror (both stored when the last index is 0 or n/2) turn in
+// opposite senses to keep the spectrum Hermitian
+//
+static void makeRotors (fftwf_complex* rotor, const uint8_t numDims, const size_t* n,
+    const float rate, const int randSeed) {
+
+  const uint8_t last = numDims-1;
+  const size_t nlast = n[last];
+  const size_t nlc = nlast/2+1;
+  size_t nrows = 1;
+  for (uint8_t d=0; d<last; d++) nrows *= n[d];
+
+  #pragma omp parallel for schedule(static)
+  for (size_t r=0; r<nrows; r++) {
+
+    // where is this row, and where is its mirror?
+    size_t rem = r;
+    size_t mirror = 0;
+    size_t stride = 1;
+    size_t rowKsq = 0;
+    for (int d=last-1; d>=0; d--) {
+      const size_t i = rem % n[d];
+      rem /= n[d];
+      mirror += ((n[d]-i) % n[d]) * stride;
+      stride *= n[d];
+      rowKsq += ringSquare(i, n[d]);
+    }
+
+    for (size_t j=0; j<nlc; j++) {
+      const size_t bin = r*nlc + j;
+      float sense;
+      if (j == 0 || (nlast%2 == 0 && j == nlast/2)) {
+        const size_t mbin = mirror*nlc + j;
+        if (mbin == bin) sense = 0.0;
+        else if (bin < mbin) sense = binDirection(bin, randSeed);
+        else sense = -binDirection(mbin, randSeed);
+      } else {
+        sense = binDirection(bin, randSeed);
+      }
+      const float turn = sense * rate * sqrt(sqrt((float)(rowKsq + j*j)));
+      rotor[bin][0] = cos(turn);
+      rotor[bin][1] = sin(turn);
+    }
+  }
+}
+
+
+//
+// Free the spectrum, the phase turns and the two frames
+//
+static void freeFrames (fftwf_complex* spec, fftwf_complex* rotor, float** work) {
+  if (spec) fftwf_free(spec);
+  if (rotor) fftwf_free(rotor);
+  if (work[0]) fftwf_free(work[0]);
+  if (work[1]) fftwf_free(work[1]);
+}
+
+
+/*
+ * Make and write frames frames of 2D or 3D noise; frame 0 is what a
+ * still run with the same options would make, and the spectrum can
+ * come from fresh noise or from a saved spectrum file
+ */
+int makeAnimation (const uint8_t numDims, const size_t* n, const size_t frames,
+    const float rate,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored, const BOOL synthesize,
+    const char* spectrumIn,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const BOOL zeroMean, const OUTFF outtype, const char* outfile) {
+
+  size_t ntotal = 1;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= n[d];
+  const size_t nlast = n[numDims-1];
+  const size_t nrows = ntotal / nlast;
+  const size_t nc = nrows * (nlast/2+1);
+  const ptrdiff_t dims[MAXDIMS] = {(ptrdiff_t)n[0], (ptrdiff_t)n[1], (ptrdiff_t)n[2]};
+
+  // the evolving spectrum, the phase turns, and two frames, so that
+  // one can be written while the other is made
+  fftwf_complex* spec = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+  fftwf_complex* rotor = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+  float* work[2];
+  work[0] = (float*) fftwf_malloc(2*nc*sizeof(float));
+  work[1] = (float*) fftwf_malloc(2*nc*sizeof(float));
+  if (!spec || !rotor || !work[0] || !work[1]) {
+    fprintf(stderr,"ERROR (makeAnimation): could not allocate the frames\n");
+    freeFrames(spec, rotor, work);
+    return(1);
+  }
+
+  // the starting spectrum, shaped as in a still run
+  if (spectrumIn) {
+    if (shapeSavedSpectrum(spectrumIn, numDims, n, spec, colored,
+                           longestWavelength, shortestWavelength, exponent,
+                           numPlanes, pp)) {
+      freeFrames(spec, rotor, work);
+      return(1);
+    }
+  } else {
+    float* white = (float*)spec;
+    const float whiteStddev = gaussian ? 1.0 : 1.0/sqrt(3.0);
+    if (synthesize) {
+      if (numDims == 2) synthesize2D(white,generator,randSeed,n[0],n[1],whiteStddev);
+      else synthesize3D(white,generator,randSeed,n[0],n[1],n[2],whiteStddev);
+    } else {
+      if (gaussian) getRandomGaussian(generator,randSeed,white,ntotal,0.0,1.0);
+      else getRandomUniform(generator,randSeed,white,ntotal,-1.0,1.0);
+      padRealArray(white, nrows, nlast);
+      if (executeR2C(numDims, dims, white, spec)) {
+        freeFrames(spec, rotor, work);
+        return(1);
+      }
+    }
+
+    float ntotalf = 1.0;
+    for (uint8_t d=0; d<numDims; d++) ntotalf *= (float)n[d];
+    NOISEFILTER nf;
+    if (colored) {
+      if (makeNoiseFilter(&nf, numDims, n, 1.0/ntotalf,
+                          longestWavelength, shortestWavelength, exponent, numPlanes, pp)) {
+        freeFrames(spec, rotor, work);
+        return(1);
+      }
+    } else {
+      initFilter(&nf.filter, numDims, n, 1.0/ntotalf);
+    }
+    const int noFilter = applyFilter(spec, &nf.filter);
+    if (colored) freeNoiseFilter(&nf);
+    if (noFilter) {
+      freeFrames(spec, rotor, work);
+      return(1);
+    }
+  }
+
+  makeRotors(rotor, numDims, n, rate, randSeed);
+
+  FRAMEWRITER w;
+  w.numDims = numDims;
+  for (uint8_t d=0; d<MAXDIMS; d++) w.n[d] = n[d];
+  w.outtype = outtype;
+  w.outfile = outfile;
+  startWriter(&w);
+
+  int failed = 0;
+  for (size_t f=0; f<frames && !failed; f++) {
+    float* frame = work[f%2];
+    fftwf_complex* cframe = (fftwf_complex*)frame;
+
+    // turn every phase, keeping a copy for the transform to destroy
+    if (f == 0) {
+      memcpy(cframe, spec, nc*sizeof(fftwf_complex));
+    } else {
+      #pragma omp parallel for schedule(static)
+      for (size_t i=0; i<nc; i++) {
+        const float re = spec[i][0]*rotor[i][0] - spec[i][1]*rotor[i][1];
+        const float im = spec[i][0]*rotor[i][1] + spec[i][1]*rotor[i][0];
+        spec[i][0] = re;
+        spec[i][1] = im;
+        cframe[i][0] = re;
+        cframe[i][1] = im;
+      }
+    }
+
+    if (executeC2R(numDims, dims, cframe, frame)) {
+      failed = 1;
+      break;
+    }
+    unpadRealArray(frame, nrows, nlast, 1.0);
+
+    // as in the still runs, only 2D honors -zero
+    if (zeroMean && numDims == 2) normalizeInPlace(frame, ntotal);
+
+    if (queueFrame(&w, frame, f)) failed = 1;
+  }
+
+  if (endWriter(&w)) failed = 1;
+  freeFrames(spec, rotor, work);
+
+  return(failed);
+}
@@ -0,0 +1,39 @@
+/*
+ * animate.h - part of noisegen
+ *
+ * 2-D and 3-D noise that evolves from frame to frame
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+#include "output.h"
+#include "planes.h"
+#include "rng.hpp"
+
+// default phase advance per frame, in radians at |k|=1
+#define ANIMATERATE 0.2
+
+int makeAnimation (const uint8_t, const size_t*, const size_t, const float,
+                   const RNG, const int, const BOOL, const BOOL, const BOOL,
+                   const char*,
+                   const float, const float, const float,
+                   const uint32_t, const PLANE*,
+                   const BOOL, const OUTFF, const char*);
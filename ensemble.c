@@ -0,0 +1,198 @@
+/*
+ * ensemble.c - part of noisegen
+ *
+ * Make many realizations of the same noise in one run. Realization r
+ * uses seed+r, so the first one is what a single run would make. The
+ * 2D and 3D ones go through the transforms in batches, one padded
+ * array after another, so that one plan and one buffer serve them all.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "filter.h"
+#include "output1d.h"
+#include "output2d.h"
+#include "output3d.h"
+#include "ensemble.h"
+
+
+//
+// out.png becomes out_0000.png, out_0001.png, and so on; name must
+// have room for 16 more characters than outfile
+//
+void ensembleFileName (const char* outfile, const size_t r, char* name) {
+
+  // only a dot in the last part of the path starts an extension
+  const char* slash = strrchr(outfile,'/');
+  const char* dot = strrchr(outfile,'.');
+  if (dot && slash && dot < slash) dot = NULL;
+
+  const size_t stem = dot ? (size_t)(dot-outfile) : strlen(outfile);
+  memcpy(name, outfile, stem);
+  sprintf(name+stem, "_%04zu%s", r, dot ? dot : "");
+}
+
+
+//
+// Write one realization to its own file, return 1 if it failed
+//
+static int writeMember (const uint8_t numDims, const size_t* n,
+    const OUTFF outtype, const char* outfile, const size_t r, float* data) {
+
+  char name[255+16];
+  ensembleFileName(outfile, r, name);
+
+  if (numDims == 1) {
+    return writeData1D(outtype, name, data, n[0]);
+  } else if (numDims == 2) {
+    return writeData2D(outtype, name, data, n[0], n[1]);
+  } else {
+    return writeData3D(outtype, name, data, n[0], n[1], n[2]);
+  }
+}
+
+
+/*
+ * Generate, color, and write count realizations; the filter and the
+ * plans are made once, and batches are as large as the memory budget
+ * allows
+ */
+int makeEnsemble (const uint8_t numDims, const size_t* n, const size_t count,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored, const BOOL synthesize,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const BOOL zeroMean, const OUTFF outtype, const char* outfile) {
+
+  size_t ntotal = 1;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= n[d];
+
+  // any member that cannot be written fails the run, but the rest are
+  // still written
+  int failed = 0;
+
+  // 1D noise is small and has its own spectral shift, so one at a time
+  if (numDims == 1) {
+    float* data = (float*) malloc(ntotal*sizeof(float));
+    for (size_t r=0; r<count; r++) {
+      if (gaussian) {
+        getRandomGaussian(generator,randSeed+(int)r,data,ntotal,0.0,1.0);
+      } else {
+        getRandomUniform(generator,randSeed+(int)r,data,ntotal,-1.0,1.0);
+      }
+      if (colored &&
+          shiftSpectrum1D(data,ntotal,longestWavelength,shortestWavelength,exponent)) {
+        free(data);
+        return(1);
+      }
+      if (writeMember(numDims, n, outtype, outfile, r, data)) failed = 1;
+    }
+    free(data);
+    return(failed);
+  }
+
+  // one padded in-place array, which also holds one spectrum
+  const size_t nlast = n[numDims-1];
+  const size_t nrows = ntotal / nlast;
+  const size_t padded = nrows * 2*(nlast/2+1);
+
+  size_t batch = ENSEMBLEBYTES / (padded*sizeof(float));
+  if (batch < 1) batch = 1;
+  if (batch > count) batch = count;
+  if (!colored) batch = 1;
+
+  float* data = (float*) fftwf_malloc(batch*padded*sizeof(float));
+  if (!data) {
+    fprintf(stderr,"ERROR (makeEnsemble): could not allocate %zu realizations\n",batch);
+    return(1);
+  }
+
+  const ptrdiff_t dims[MAXDIMS] = {(ptrdiff_t)n[0], (ptrdiff_t)n[1], (ptrdiff_t)n[2]};
+  const float whiteStddev = gaussian ? 1.0 : 1.0/sqrt(3.0);
+
+  // the same filter for every member, 1/N included
+  NOISEFILTER nf;
+  if (colored && makeNoiseFilter(&nf, numDims, n, 1.0/(float)ntotal,
+                                  longestWavelength, shortestWavelength, exponent,
+                                  numPlanes, pp)) {
+    fftwf_free(data);
+    return(1);
+  }
+
+  for (size_t r0=0; r0<count; r0+=batch) {
+    const size_t nb = (count-r0 < batch) ? count-r0 : batch;
+
+    // white noise, or its spectrum, for every member of the batch
+    for (size_t b=0; b<nb; b++) {
+      float* member = data + b*padded;
+      const int seed = randSeed + (int)(r0+b);
+
+      if (synthesize) {
+        if (numDims == 2) {
+          synthesize2D(member,generator,seed,n[0],n[1],whiteStddev);
+        } else {
+          synthesize3D(member,generator,seed,n[0],n[1],n[2],whiteStddev);
+        }
+      } else {
+        if (gaussian) {
+          getRandomGaussian(generator,seed,member,ntotal,0.0,1.0);
+        } else {
+          getRandomUniform(generator,seed,member,ntotal,-1.0,1.0);
+        }
+        if (colored) padRealArray(member, nrows, nlast);
+      }
+    }
+
+    if (colored) {
+      BOOL stopped = !synthesize && executeManyR2C(numDims, dims, (ptrdiff_t)nb, data);
+      if (!stopped) {
+        for (size_t b=0; b<nb && !stopped; b++) {
+          stopped = applyFilter(data + b*padded, &nf.filter);
+        }
+        if (!stopped) stopped = executeManyC2R(numDims, dims, (ptrdiff_t)nb, data);
+      }
+      if (stopped) {
+        freeNoiseFilter(&nf);
+        fftwf_free(data);
+        return(1);
+      }
+    }
+
+    for (size_t b=0; b<nb; b++) {
+      float* member = data + b*padded;
+      if (colored) unpadRealArray(member, nrows, nlast, 1.0);
+      // as in the single runs, only 2D honors -zero
+      if (zeroMean && numDims == 2) normalizeInPlace(member, ntotal);
+      if (writeMember(numDims, n, outtype, outfile, r0+b, member)) failed = 1;
+    }
+  }
+
+  if (colored) freeNoiseFilter(&nf);
+  fftwf_free(data);
+
+  return(failed);
+}
@@ -22,6 +22,7 @@
 
 #include <stdint.h>
 #include "planes.h"
+#include "rng.hpp"
 
 // Windows lacks fminf
 #ifndef fminf
@@ -32,18 +33,24 @@
 #define fmaxf(x, y) (((x) > (y)) ? (x) : (y))
 #endif
 
+void setPlannerEffort (const unsigned);
+unsigned getPlannerEffort ();
+void setFFTThreads (const int);
+int loadWisdom (const char*);
+int saveWisdom (const char*);
+void clearPlanCache ();
+
 int shiftSpectrum1D (float*, const size_t, const float, const float, const float);
 void normalizeInPlace (float*, const size_t);
+float* makePowerLawTable (const size_t, const float, const float, const float);
+size_t* makeWavenumberSquares (const size_t);
+void padRealArray (float*, const size_t, const size_t);
+void unpadRealArray (float*, const size_t, const size_t, const float);
+void scalePaddedArray (float*, const size_t, const size_t, const float);
 
-void* decompose2D (float*, const size_t, const size_t);
-int shiftPowerSpectrum2D (void*, const size_t, const size_t, const float, const float, const float);
-int addPlanesToSpectrum2D (void*, const size_t, const size_t, const uint32_t, const PLANE*);
-int reproject2D (void*, const size_t, const size_t, float*);
+void* synthesize2D (float*, const RNG, const int, const size_t, const size_t, const float);
 
-void* decompose3D (float*, const size_t, const size_t, const size_t);
-int shiftPowerSpectrum3D (void*, const size_t, const size_t, const size_t, const float, const float, const float);
-int addPlanesToSpectrum3D (void*, const size_t, const size_t, const size_t, const uint32_t, const PLANE*);
-int reproject3D (void*, const size_t, const size_t, const size_t, float*);
+void* synthesize3D (float*, const RNG, const int, const size_t, const size_t, const size_t, const float);
 
 int forward1Dfc (float*, const size_t);
 int inverse1Dfc (float*, const size_t);
@@ -23,9 +23,12 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <fftw3.h>
 #include "fft.h"
+#include "fftplan.h"
 
 
 /*
@@ -38,17 +41,16 @@ int shiftSpectrum1D (float *inout, const size_t n,
     const float exponent) {
 
   fftwf_complex *data;
-  fftwf_plan pforward, pinverse;
+  const ptrdiff_t dims[1] = {(ptrdiff_t)n};
 
   // the working data, complex
   data = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * (n/2+1));
 
-  // the forward and backward plans
-  pforward = fftwf_plan_dft_r2c_1d(n, inout, data, FFTW_ESTIMATE);
-  pinverse = fftwf_plan_dft_c2r_1d(n, data, inout, FFTW_ESTIMATE);
-
   // execute the forward DFT
-  fftwf_execute(pforward);
+  if (executeR2C(1, dims, inout, data)) {
+    fftwf_free(data);
+    return(1);
+  }
 
   // scale the frequency components
   for (size_t i=1; i<n/2+1; i++) {
@@ -83,7 +85,9 @@ int shiftSpectrum1D (float *inout, const size_t n,
   fprintf(stderr,"dc signal is %g\n",dcSignal);
 
   // then perform an IFT to reconstitute the real signal
-  fftwf_execute(pinverse);
+  const int failed = executeC2R(1, dims, data, inout);
+  fftwf_free(data);
+  if (failed) return(1);
 
   // should we normalize?
   float factor = 1./(float)n;
@@ -107,10 +111,9 @@ int shiftSpectrum1D (float *inout, const size_t n,
 int forward1Dfc (float *inout, const size_t n) {
 
   fftwf_complex *data;
-  fftwf_plan p;
+  const ptrdiff_t dims[1] = {(ptrdiff_t)n};
 
   data = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * n);
-  p = fftwf_plan_dft_1d(n, data, data, FFTW_FORWARD, FFTW_ESTIMATE);
 
   // fill the arrays
   for (size_t i=0; i<n; i++) {
@@ -118,7 +121,10 @@ int forward1Dfc (float *inout, const size_t n) {
     data[i][1] = 0.0;
   }
 
-  fftwf_execute(p); /* repeat as needed */
+  if (executeC2C(1, dims, data, data, FFTW_FORWARD)) {
+    fftwf_free(data);
+    return(1);
+  }
 
   // put data back into original array
   for (size_t i=0; i<n; i++) {
@@ -126,7 +132,6 @@ int forward1Dfc (float *inout, const size_t n) {
     //printf("%d  %g  %g\n",i,data[i][0],data[i][1]);
   }
 
-  fftwf_destroy_plan(p);
   fftwf_free(data);
 
   return(0);
@@ -139,10 +144,9 @@ int forward1Dfc (float *inout, const size_t n) {
 int inverse1Dfc (float *inout, const size_t n) {
 
   fftwf_complex *data;
-  fftwf_plan p;
+  const ptrdiff_t dims[1] = {(ptrdiff_t)n};
 
   data = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * n);
-  p = fftwf_plan_dft_1d(n, data, data, FFTW_BACKWARD, FFTW_ESTIMATE);
 
   // fill the arrays
   for (size_t i=0; i<n; i++) {
@@ -150,20 +154,115 @@ int inverse1Dfc (float *inout, const size_t n) {
     data[i][1] = 0.0;
   }
 
-  fftwf_execute(p); /* repeat as needed */
+  if (executeC2C(1, dims, data, data, FFTW_BACKWARD)) {
+    fftwf_free(data);
+    return(1);
+  }
 
   // put data back into original array
   for (size_t i=0; i<n; i++) {
     inout[i] = data[i][0];
   }
 
-  fftwf_destroy_plan(p);
   fftwf_free(data);
 
   return(0);
 }
 
 
+//
+// Make the table of spectral scale factors for every integer value of
+// diag = 1 + |k|^2 up to maxDiag, that is diag^exponent, with the
+// band-pass cutoffs already folded in as zeros (DC is never cut); the
+// powers are taken in double and rounded to float, as they always were,
+// so the factors match the old per-bin ones wherever the old float sum
+// for diag was exact, which is every diag below 2^24; NULL if there is
+// no room for it
+//
+float* makePowerLawTable (const size_t maxDiag, const float exponent,
+    const float longestWavelength, const float shortestWavelength) {
+
+  float* table = (float*) malloc((maxDiag+1)*sizeof(float));
+  if (!table) {
+    fprintf(stderr,"ERROR (makePowerLawTable): could not allocate %zu factors\n",maxDiag+1);
+    return NULL;
+  }
+  table[0] = 0.0;
+
+  for (size_t d=1; d<=maxDiag; d++) {
+    table[d] = (float) pow((double)d, (double)exponent);
+    if (d > 1) {
+      const float wavelength = 1.0 / sqrt((double)d - 1.0);
+      if (wavelength > longestWavelength && longestWavelength > 0.0) table[d] = 0.0;
+      if (wavelength < shortestWavelength && shortestWavelength > 0.0) table[d] = 0.0;
+    }
+  }
+
+  return table;
+}
+
+//
+// Squared signed wavenumber for every index along one axis, using the
+// same (n-i) folding as always; the largest entry is at i=n/2
+//
+size_t* makeWavenumberSquares (const size_t n) {
+
+  size_t* ksq = (size_t*) malloc(n*sizeof(size_t));
+  for (size_t i=0; i<n; i++) {
+    const size_t k = (i < n/2) ? i : n-i;
+    ksq[i] = k*k;
+  }
+  return ksq;
+}
+
+
+//
+// Spread nrows contiguous rows of n reals out to the FFTW in-place
+// layout, where each row is padded to 2*(n/2+1); the array must
+// already have room for the padded size
+//
+void padRealArray (float* inout, const size_t nrows, const size_t n) {
+
+  const size_t np = 2*(n/2+1);
+
+  // work from the back so that no row overwrites one not yet moved
+  for (size_t r=nrows; r-- > 1; ) {
+    memmove(inout+r*np, inout+r*n, n*sizeof(float));
+  }
+}
+
+//
+// Squeeze padded rows back together, scaling as we go; rows overlap
+// their neighbors as they move, so this one has to run in order
+//
+void unpadRealArray (float* inout, const size_t nrows, const size_t n, const float scale) {
+
+  const size_t np = 2*(n/2+1);
+
+  for (size_t r=0; r<nrows; r++) {
+    float* dst = inout+r*n;
+    if (r > 0) memmove(dst, inout+r*np, n*sizeof(float));
+    if (scale != 1.0) {
+      for (size_t i=0; i<n; i++) dst[i] *= scale;
+    }
+  }
+}
+
+//
+// Scale the real values of a padded array, leaving the padding alone
+//
+void scalePaddedArray (float* inout, const size_t nrows, const size_t n, const float scale) {
+
+  const size_t np = 2*(n/2+1);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t r=0; r<nrows; r++) {
+    float* row = inout+r*np;
+    for (size_t i=0; i<n; i++) row[i] *= scale;
+  }
+}
+
+
 //
 // Take any real signal, normalize to mean=0 and min=-max
 //
@@ -36,183 +36,39 @@ void writeSpectrum2D (OUTFF, char*, fftwf_complex*, size_t, size_t);
 
 
 /*
- * Take any real 2D signal, r2c forward transform,
+ * Make the r2c spectrum of 2D white noise directly, skipping the real
+ * signal and the forward transform; stddev is that of the white noise
+ * that this replaces, the coefficients themselves are always Gaussian;
+ * out must have room for nx*(ny/2+1) complex values
  */
-void* decompose2D (float* in,
-    const size_t nx, const size_t ny) {
-
-  fftwf_complex* data;
-  fftwf_plan pforward;
-
-  // the working data, complex
-  data = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * nx * (ny/2+1));
-
-  // the forward
-  pforward = fftwf_plan_dft_r2c_2d(nx, ny, in, data, FFTW_ESTIMATE);
-
-  // execute the forward DFT
-  fftwf_execute(pforward);
-
-  // clear the temporary object
-  fftwf_destroy_plan(pforward);
-
-  // DEBUG print the input
-  if (DEBUG) {
-    writeData2D(png,"tempoutA.png",in,nx,ny);
-  }
-
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    writeSpectrum2D(png,"tempoutB.png",data,nx,ny);
-  }
-
-  return data;
-}
-
-
-/*
- * Take the complex 2D spectrum and shift the power relationship
- */
-int shiftPowerSpectrum2D (void *inout,
-    const size_t nx, const size_t ny,
-    const float loFreqCutWavelen, const float hiFreqCutWavelen,
-    const float exponent) {
-
-  fftwf_complex* data = (fftwf_complex*)inout;
-
-  // in 2D, we need to adjust the exponent
-  // it's /2 because we need to take the sqrt of the distance from the origin!
-  const float thisexp = exponent / 2.0;
-
-  // scale the frequency components
-  for (size_t i=0; i<nx; i++) {
-    for (size_t j=0; j<ny/2+1; j++) {
-
-      float diag = 1.0 + j*j;
-      if (i < nx/2) diag += i*i;
-      else diag += (nx-i)*(nx-i);
-
-      // adjust magnitude at this frequency to match noise "color"
-      float factor = pow(diag, thisexp);
-      data[i*(ny/2+1)+j][0] *= factor;
-      data[i*(ny/2+1)+j][1] *= factor;
-
-      // adjust magnitude to crop out frequencies
-      if (!(i == 0 && j == 0)) {
-        const float wavelength = 1.0 / sqrt(diag - 1.0);
-        if (wavelength > loFreqCutWavelen && loFreqCutWavelen > 0.0) {
-          data[i*(ny/2+1)+j][0] = 0.0;
-          data[i*(ny/2+1)+j][1] = 0.0;
-        }
-        if (wavelength < hiFreqCutWavelen && hiFreqCutWavelen > 0.0) {
-          data[i*(ny/2+1)+j][0] = 0.0;
-          data[i*(ny/2+1)+j][1] = 0.0;
-        }
+void* synthesize2D (float* out, const RNG generator, const int randSeed,
+    const size_t nx, const size_t ny, const float stddev) {
+
+  const size_t nyc = ny/2+1;
+  fftwf_complex* data = (fftwf_complex*)out;
+
+  // every coefficient has variance N*stddev^2, split over re and im
+  const float sigma = stddev * sqrt(0.5*(float)nx*(float)ny);
+  getRandomGaussian(generator, randSeed, (float*)data, 2*nx*nyc, 0.0, sigma);
+
+  // the j=0 and (even ny) j=ny/2 columns hold both k and -k, so they
+  // must be Hermitian along i, and the self-conjugate bins must be real
+  const size_t ncols = (ny%2 == 0 && ny > 1) ? 2 : 1;
+  for (size_t c=0; c<ncols; c++) {
+    const size_t j = c*(ny/2);
+    for (size_t i=0; i<nx; i++) {
+      const size_t im = (nx-i)%nx;
+      if (im == i) {
+        data[i*nyc+j][0] *= sqrt(2.0);
+        data[i*nyc+j][1] = 0.0;
+      } else if (i > im) {
+        data[i*nyc+j][0] = data[im*nyc+j][0];
+        data[i*nyc+j][1] = -data[im*nyc+j][1];
       }
     }
   }
-  float dcSignal = data[0][0] / ((float)ny*(float)nx);
-  fprintf(stderr,"dc signal is %g\n",dcSignal);
 
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    float* temp = (float*)malloc(sizeof(float)*nx*(ny/2+1));
-    for (size_t i=0; i<nx*(ny/2+1); i++) temp[i] = data[i][0];
-    writeData2D(png,"tempoutC.png",temp,nx,ny/2+1);
-    free(temp);
-  }
-  if (DEBUG) {
-    writeSpectrum2D(png,"tempoutC1.png",data,nx,ny);
-  }
-
-  return(0);
-}
-
-
-/*
- * Take any complex 2D spectrum and add streaks to the data
- */
-int addPlanesToSpectrum2D (void* in,
-    const size_t nx, const size_t ny,
-    const uint32_t numPlanes, const PLANE* pp) {
-
-  // re-cast the void* to complex*
-  fftwf_complex* data = (fftwf_complex*)in;
-
-  // save the aspect ratio
-  const float ar = (float)nx/(float)ny;
-
-  // add a streak to the frequency components
-  for (size_t i=0; i<nx; i++) {
-    for (size_t j=0; j<ny/2+1; j++) {
-      if (i!=0 || j!=0) {
-
-        float thisAngle;
-        if (i < nx/2) thisAngle = atanf(-(float)i/(float)j);
-        else thisAngle = atanf((float)(nx-i)/(float)j);
-
-        float factor = 0.0;
-        for (uint32_t ip=0; ip < numPlanes; ip++) {
-
-          //float planeAngle = atanf(ar*pp[ip].vec[1]/pp[ip].vec[0]);
-          float planeAngle = atanf(ar*pp[ip].vec[0]/pp[ip].vec[1]);
-          float diffAngle = fabs(thisAngle-planeAngle);
-          // need to make sure we don't miss it in the reflection
-          diffAngle = fminf(diffAngle, fabs(thisAngle-planeAngle+M_PI));
-          diffAngle = fminf(diffAngle, fabs(thisAngle-planeAngle-M_PI));
-          // add up the factors
-          factor += pp[ip].strength * fmaxf(0.0, 1.0-diffAngle/pp[ip].width);
-        }
-        factor += 1.0;
-
-        data[i*(ny/2+1)+j][0] *= factor;
-        data[i*(ny/2+1)+j][1] *= factor;
-      }
-    }
-  }
-
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    float* temp = (float*)malloc(sizeof(float)*nx*(ny/2+1));
-    for (size_t i=0; i<nx*(ny/2+1); i++) temp[i] = data[i][0];
-    writeData2D(png,"tempoutD.png",temp,nx,ny/2+1);
-    free(temp);
-  }
-  if (DEBUG) {
-    writeSpectrum2D(png,"tempoutD1.png",data,nx,ny);
-  }
-
-  return(0);
-}
-
-
-/*
- * Take any complex 2D spectrum and c2r inverse transform
- * it back into a real signal
- */
-int reproject2D (void* in,
-    const size_t nx, const size_t ny,
-    float* out) {
-
-  fftwf_complex* data = (fftwf_complex*)in;
-
-  // the backward plan
-  fftwf_plan pinverse = fftwf_plan_dft_c2r_2d(nx, ny, data, out, FFTW_ESTIMATE);
-
-  // then perform an IFT to reconstitute the real signal
-  fftwf_execute(pinverse);
-
-  // free the complex data
-  fftwf_destroy_plan(pinverse);
-  fftwf_free(data);
-
-  // should we normalize?
-  float factor = 1. / ((float)ny*(float)nx);
-  for (size_t i=0; i<nx*ny; i++) {
-    out[i] *= factor;
-  }
-
-  return(0);
+  return data;
 }
 
 
@@ -36,195 +36,44 @@
 
 
 /*
- * Take any real 3D signal, r2c forward transform,
+ * Make the r2c spectrum of 3D white noise directly, skipping the real
+ * signal and the forward transform; stddev is that of the white noise
+ * that this replaces, the coefficients themselves are always Gaussian;
+ * out must have room for nx*ny*(nz/2+1) complex values
  */
-void* decompose3D (float* in,
-    const size_t nx, const size_t ny, const size_t nz) {
-
-  fftwf_complex* data;
-  fftwf_plan pforward;
-
-  // the working data, complex
-  data = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * nx * ny * (nz/2+1));
-
-  // the forward
-  pforward = fftwf_plan_dft_r2c_3d(nx, ny, nz, in, data, FFTW_ESTIMATE);
-
-  // execute the forward DFT
-  fftwf_execute(pforward);
-
-  // clear the temporary object
-  fftwf_destroy_plan(pforward);
-
-  // DEBUG print the input
-  if (DEBUG) {
-    writeData2D(png,"tempoutA.png",in,ny,nz);
-  }
-
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    //writeSpectrum2D(png,"tempoutB.png",data,ny,nz);
-  }
-
-  return data;
-}
-
-
-/*
- * Take the complex 3D spectrum and shift the power relationship
- */
-int shiftPowerSpectrum3D (void *inout,
-    const size_t nx, const size_t ny, const size_t nz,
-    const float longestWavelength, const float shortestWavelength,
-    const float exponent) {
-
-  fftwf_complex* data = (fftwf_complex*)inout;
-
-  // in 3D, we need to adjust the exponent
-  // it's /2 because we need to take the sqrt of the distance from the origin!
-  const float thisexp = exponent / 2.0;
-
-  // scale the frequency components
-  for (size_t i=0; i<nx; i++) {
-    for (size_t j=0; j<ny; j++) {
-      for (size_t k=0; k<nz/2+1; k++) {
-
-        float diag = 1 + k*k;
-        if (j < ny/2) diag += j*j;
-        else diag += (ny-j)*(ny-j);
-        if (i < nx/2) diag += i*i;
-        else diag += (nx-i)*(nx-i);
-
-        float factor = pow(diag, thisexp);
-        size_t ijk = (i*ny + j)*(nz/2+1) + k;
-        data[ijk][0] *= factor;
-        data[ijk][1] *= factor;
-
-        // band-pass filter by wavelength
-        if (ijk != 0) {
-          const float wavelength = 1.0 / sqrt(diag - 1.0);
-          if (wavelength > longestWavelength && longestWavelength > 0.0) {
-            data[ijk][0] = 0.0;
-            data[ijk][1] = 0.0;
-          }
-          if (wavelength < shortestWavelength && shortestWavelength > 0.0) {
-            data[ijk][0] = 0.0;
-            data[ijk][1] = 0.0;
-          }
+void* synthesize3D (float* out, const RNG generator, const int randSeed,
+    const size_t nx, const size_t ny, const size_t nz, const float stddev) {
+
+  const size_t nzc = nz/2+1;
+  fftwf_complex* data = (fftwf_complex*)out;
+
+  // every coefficient has variance N*stddev^2, split over re and im
+  const float sigma = stddev * sqrt(0.5*(float)nx*(float)ny*(float)nz);
+  getRandomGaussian(generator, randSeed, (float*)data, 2*nx*ny*nzc, 0.0, sigma);
+
+  // the k=0 and (even nz) k=nz/2 planes hold both k and -k, so they
+  // must be Hermitian in i,j, and the self-conjugate bins must be real
+  const size_t nplanes = (nz%2 == 0 && nz > 1) ? 2 : 1;
+  for (size_t c=0; c<nplanes; c++) {
+    const size_t k = c*(nz/2);
+    for (size_t i=0; i<nx; i++) {
+      const size_t im = (nx-i)%nx;
+      for (size_t j=0; j<ny; j++) {
+        const size_t jm = (ny-j)%ny;
+        const size_t ijk = (i*ny + j)*nzc + k;
+        const size_t mirror = (im*ny + jm)*nzc + k;
+        if (mirror == ijk) {
+          data[ijk][0] *= sqrt(2.0);
+          data[ijk][1] = 0.0;
+        } else if (ijk > mirror) {
+          data[ijk][0] = data[mirror][0];
+          data[ijk][1] = -data[mirror][1];
         }
       }
     }
   }
-  float dcSignal = data[0][0] / ((float)ny*(float)nx);
-  fprintf(stderr,"dc signal is %g\n",dcSignal);
 
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    float* temp = (float*)malloc(sizeof(float)*nx*(ny/2+1));
-    for (size_t i=0; i<nx*(ny/2+1); i++) temp[i] = data[i][0];
-    writeData2D(png,"tempoutC.png",temp,nx,ny/2+1);
-    free(temp);
-  }
-  if (DEBUG) {
-    //writeSpectrum2D(png,"tempoutC1.png",data,nx,ny);
-  }
-
-  return(0);
-}
-
-
-/*
- * Take any complex 3D spectrum and add streaks to the data
- */
-int addPlanesToSpectrum3D (void* in,
-    const size_t nx, const size_t ny, const size_t nz,
-    const uint32_t numPlanes, const PLANE* pp) {
-
-  // re-cast the void* to complex*
-  fftwf_complex* data = (fftwf_complex*)in;
-
-  // save the aspect ratio
-  // NOT DONE
-  const float ar = (float)nx/(float)ny;
-
-  // normalize the plane normal vectors
-  // NOT DONE
-
-  // add a streak to the frequency components
-  // NOT DONE
-  for (size_t i=0; i<nx; i++) {
-    for (size_t j=0; j<ny; j++) {
-      for (size_t k=0; k<nz/2+1; k++) {
-        if (i!=0 && j!=0 && k!=0) {
-
-          float thisAngle;
-          if (i < nx/2) thisAngle = atanf(-(float)i/(float)j);
-          else thisAngle = atanf((float)(nx-i)/(float)j);
-
-          float factor = 0.0;
-          for (uint32_t ip=0; ip < numPlanes; ip++) {
-
-            //float planeAngle = atanf(ar*pp[ip].vec[1]/pp[ip].vec[0]);
-            float planeAngle = atanf(ar*pp[ip].vec[0]/pp[ip].vec[1]);
-            float diffAngle = fabs(thisAngle-planeAngle);
-            // need to make sure we don't miss it in the reflection
-            diffAngle = fminf(diffAngle, fabs(thisAngle-planeAngle+M_PI));
-            diffAngle = fminf(diffAngle, fabs(thisAngle-planeAngle-M_PI));
-            // add up the factors
-            factor += pp[ip].strength * fmaxf(0.0, 1.0-diffAngle/pp[ip].width);
-          }
-          factor += 1.0;
-
-          size_t ijk = (i*ny + j)*(nz/2+1) + k;
-          data[ijk][0] *= factor;
-          data[ijk][1] *= factor;
-        }
-      }
-    }
-  }
-
-  // DEBUG print the frequency components
-  if (DEBUG) {
-    float* temp = (float*)malloc(sizeof(float)*nx*(ny/2+1));
-    for (size_t i=0; i<nx*(ny/2+1); i++) temp[i] = data[i][0];
-    writeData2D(png,"tempoutD.png",temp,nx,ny/2+1);
-    free(temp);
-  }
-  if (DEBUG) {
-    //writeSpectrum2D(png,"tempoutD1.png",data,nx,ny);
-  }
-
-  return(0);
-}
-
-
-/*
- * Take any complex 3D spectrum and c2r inverse transform
- * it back into a real signal
- */
-int reproject3D (void* in,
-    const size_t nx, const size_t ny, const size_t nz,
-    float* out) {
-
-  fftwf_complex* data = (fftwf_complex*)in;
-
-  // the backward plan
-  fftwf_plan pinverse = fftwf_plan_dft_c2r_3d(nx, ny, nz, data, out, FFTW_ESTIMATE);
-
-  // then perform an IFT to reconstitute the real signal
-  fftwf_execute(pinverse);
-
-  // free the complex data
-  fftwf_destroy_plan(pinverse);
-  fftwf_free(data);
-
-  // should we normalize?
-  float factor = 1. / ((float)ny*(float)nx*(float)nz);
-  for (size_t i=0; i<nx*ny*nz; i++) {
-    out[i] *= factor;
-  }
-
-  return(0);
+  return data;
 }
 
 
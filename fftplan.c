@@ -0,0 +1,456 @@
+/*
+ * fftplan.c - part of noisegen
+ *
+ * Keep FFTW plans around between transforms, so that the planning cost
+ * (large for FFTW_MEASURE and above) is paid once per size. Plans are
+ * made on the caller's arrays when the planner will not touch them, and
+ * on scratch arrays when it measures, and are run with the new-array
+ * execute functions. Making plans is serialized, since the FFTW planner
+ * is not thread-safe, but finding cached ones is not held up by it, any
+ * number of threads may run them at once, and a plan that is running is
+ * never recycled.
+ *
+ * link with -lfftw3f (and -lfftw3f_threads with USE_FFTW_THREADS)
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "fft.h"
+#include "fftplan.h"
+
+typedef enum planKindType {r2c,c2r,c2cforward,c2cbackward} PLANKIND;
+
+// everything that makes one plan unusable for another transform
+typedef struct planCacheEntryType {
+  PLANKIND kind;
+  int rank;
+  ptrdiff_t n[MAXDIMS];
+  // batches of transforms, either interleaved (element stride howmany)
+  // or one whole array after another
+  ptrdiff_t howmany;
+  BOOL interleaved;
+  BOOL inPlace;
+  BOOL aligned;
+  int numThreads;
+  fftwf_plan plan;
+  // transforms running it right now
+  uint32_t users;
+} PLANENTRY;
+
+static PLANENTRY cache[MAXCACHEDPLANS];
+static uint32_t numCached = 0;
+static uint32_t nextVictim = 0;
+
+// one lock for the cache, and one for the FFTW planner, which is not
+// thread-safe; never take the cache lock while holding the planner's
+#ifndef _WIN32
+static pthread_mutex_t planLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t plannerLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCKPLANS pthread_mutex_lock(&planLock)
+#define UNLOCKPLANS pthread_mutex_unlock(&planLock)
+#define LOCKPLANNER pthread_mutex_lock(&plannerLock)
+#define UNLOCKPLANNER pthread_mutex_unlock(&plannerLock)
+#else
+#define LOCKPLANS
+#define UNLOCKPLANS
+#define LOCKPLANNER
+#define UNLOCKPLANNER
+#endif
+
+// planner rigor, one of FFTW_ESTIMATE, _MEASURE, _PATIENT, _EXHAUSTIVE
+static unsigned plannerEffort = FFTW_ESTIMATE;
+
+// threads per transform, baked into each plan when it is made
+static int planThreads = 1;
+
+
+//
+// Set the number of threads for all plans made from now on
+//
+void setFFTThreads (const int nthreads) {
+#ifdef USE_FFTW_THREADS
+  static BOOL initialized = FALSE;
+  if (!initialized) {
+    if (!fftwf_init_threads()) {
+      fprintf(stderr,"ERROR (setFFTThreads): could not start FFTW threads\n");
+      return;
+    }
+    initialized = TRUE;
+  }
+  LOCKPLANNER;
+  planThreads = (nthreads > 0) ? nthreads : 1;
+  fftwf_plan_with_nthreads(planThreads);
+  UNLOCKPLANNER;
+#else
+  (void) nthreads;
+#endif
+}
+
+
+//
+// Set the planner rigor for all plans made from now on
+//
+void setPlannerEffort (const unsigned effort) {
+  plannerEffort = effort;
+}
+
+unsigned getPlannerEffort () {
+  return plannerEffort;
+}
+
+//
+// Read previously-measured plans, return 1 if any were loaded
+//
+int loadWisdom (const char* filename) {
+  if (!filename) return 0;
+  LOCKPLANNER;
+  const int retval = fftwf_import_wisdom_from_filename(filename);
+  UNLOCKPLANNER;
+  if (retval) fprintf(stderr,"Read FFTW wisdom from %s\n",filename);
+  return retval;
+}
+
+//
+// Save all measured plans, including any loaded ones
+//
+int saveWisdom (const char* filename) {
+  if (!filename) return 0;
+  LOCKPLANNER;
+  const int retval = fftwf_export_wisdom_to_filename(filename);
+  UNLOCKPLANNER;
+  if (!retval) fprintf(stderr,"ERROR (saveWisdom): could not write %s\n",filename);
+  return retval;
+}
+
+//
+// Destroying a plan also goes through the planner
+//
+static void destroyPlan (const fftwf_plan p) {
+  LOCKPLANNER;
+  fftwf_destroy_plan(p);
+  UNLOCKPLANNER;
+}
+
+//
+// Destroy all cached plans
+//
+void clearPlanCache () {
+  LOCKPLANS;
+  for (uint32_t i=0; i<numCached; i++) destroyPlan(cache[i].plan);
+  numCached = 0;
+  nextVictim = 0;
+  UNLOCKPLANS;
+}
+
+
+//
+// The cached plan that fits, if any; call with the cache locked
+//
+static int findPlan (const PLANKIND kind, const int rank, const ptrdiff_t* n,
+    const ptrdiff_t howmany, const BOOL interleaved, const BOOL inPlace,
+    const BOOL aligned, const int numThreads) {
+  for (uint32_t i=0; i<numCached; i++) {
+    const PLANENTRY* e = &cache[i];
+    if (e->kind != kind || e->rank != rank || e->howmany != howmany) continue;
+    if (howmany > 1 && e->interleaved != interleaved) continue;
+    if (e->inPlace != inPlace || e->aligned != aligned) continue;
+    if (e->numThreads != numThreads) continue;
+    BOOL same = TRUE;
+    for (int d=0; d<rank; d++) if (e->n[d] != n[d]) same = FALSE;
+    if (same) return (int)i;
+  }
+  return -1;
+}
+
+//
+// Call the guru planner on the given arrays, which for c2r are complex in
+// and real out, and otherwise real or complex in and complex out
+//
+static fftwf_plan planOn (const PLANKIND kind, const int rank, const fftwf_iodim64* dims,
+    const int batchRank, const fftwf_iodim64* batch, void* in, void* out,
+    const unsigned flags) {
+  if (kind == r2c) {
+    return fftwf_plan_guru64_dft_r2c(rank, dims, batchRank, batch, (float*)in,
+                                     (fftwf_complex*)out, flags);
+  } else if (kind == c2r) {
+    return fftwf_plan_guru64_dft_c2r(rank, dims, batchRank, batch, (fftwf_complex*)in,
+                                     (float*)out, flags);
+  }
+  return fftwf_plan_guru64_dft(rank, dims, batchRank, batch, (fftwf_complex*)in,
+                               (fftwf_complex*)out,
+                               kind == c2cforward ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+}
+
+//
+// Make a new plan; FFTW_ESTIMATE and wisdom never touch the arrays, so
+// those plans are made on the caller's own, and only a real measurement
+// gets scratch arrays, unless they would be too big
+//
+static fftwf_plan makePlan (const PLANKIND kind, const int rank, const ptrdiff_t* n,
+    const ptrdiff_t howmany, const BOOL interleaved, const BOOL inPlace,
+    const BOOL aligned, void* in, void* out) {
+
+  // describe the row-major layout to the 64-bit guru planner; real rows
+  // are padded to 2*(n/2+1) floats in place
+  const BOOL isReal = (kind == r2c || kind == c2r);
+  const ptrdiff_t nlast = n[rank-1];
+  const ptrdiff_t nlastc = isReal ? nlast/2+1 : nlast;
+  fftwf_iodim64 dims[MAXDIMS];
+  const int batchRank = (howmany > 1) ? 1 : 0;
+  ptrdiff_t realStride = interleaved ? howmany : 1;
+  ptrdiff_t complexStride = interleaved ? howmany : 1;
+  for (int d=rank-1; d>=0; d--) {
+    dims[d].n = n[d];
+    dims[d].is = (kind == r2c) ? realStride : complexStride;
+    dims[d].os = (kind == c2r) ? realStride : complexStride;
+    if (d == rank-1) {
+      realStride *= isReal ? (inPlace ? 2*nlastc : nlast) : nlast;
+      complexStride *= nlastc;
+    } else {
+      realStride *= n[d];
+      complexStride *= n[d];
+    }
+  }
+
+  // after the loop the strides are the sizes of one whole array
+  fftwf_iodim64 batch = {howmany, 1, 1};
+  if (!interleaved) {
+    batch.is = (kind == r2c) ? realStride : complexStride;
+    batch.os = (kind == c2r) ? realStride : complexStride;
+  }
+
+  const unsigned flags = aligned ? 0 : FFTW_UNALIGNED;
+  fftwf_plan p = NULL;
+
+  LOCKPLANNER;
+  if (plannerEffort & FFTW_ESTIMATE) {
+    p = planOn(kind, rank, dims, batchRank, &batch, in, out, plannerEffort | flags);
+  } else {
+    p = planOn(kind, rank, dims, batchRank, &batch, in, out,
+               plannerEffort | FFTW_WISDOM_ONLY | flags);
+  }
+
+  if (!p && !(plannerEffort & FFTW_ESTIMATE)) {
+    // no wisdom, so measure on scratch arrays of the same shape
+    const size_t ncomplex = (size_t)(complexStride * (interleaved ? 1 : howmany));
+    const size_t nfloats = isReal ? (size_t)(realStride * (interleaved ? 1 : howmany))
+                                  : 2*ncomplex;
+    const size_t bytes = sizeof(float)*nfloats + (inPlace ? 0 : sizeof(fftwf_complex)*ncomplex);
+
+    float* sreal = NULL;
+    fftwf_complex* scomplex = NULL;
+    if (bytes <= MAXPLANSCRATCH) {
+      sreal = (float*) fftwf_malloc(sizeof(float) * nfloats);
+      scomplex = inPlace ? (fftwf_complex*)sreal :
+                           (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * ncomplex);
+    }
+
+    if (sreal && scomplex) {
+      if (kind == c2r) {
+        p = planOn(kind, rank, dims, batchRank, &batch, scomplex, sreal, plannerEffort | flags);
+      } else {
+        p = planOn(kind, rank, dims, batchRank, &batch, sreal, scomplex, plannerEffort | flags);
+      }
+    } else {
+      fprintf(stderr,"Transform too large to measure, estimating its plan instead\n");
+      p = planOn(kind, rank, dims, batchRank, &batch, in, out, FFTW_ESTIMATE | flags);
+    }
+
+    if (scomplex && !inPlace) fftwf_free(scomplex);
+    if (sreal) fftwf_free(sreal);
+  }
+  UNLOCKPLANNER;
+
+  if (!p) fprintf(stderr,"ERROR (getPlan): FFTW could not make a plan\n");
+  return p;
+}
+
+//
+// Find a matching plan, or make one and remember it; slot says where it
+// is kept, for releasePlan, and is MAXCACHEDPLANS if every slot was busy;
+// return NULL if FFTW cannot make one, and leave quitting to the caller
+//
+static fftwf_plan getPlan (const PLANKIND kind, const int rank, const ptrdiff_t* n,
+    const ptrdiff_t howmany, const BOOL interleaved, void* in, void* out,
+    uint32_t* slot) {
+
+  const BOOL inPlace = (in == out);
+  const BOOL aligned = (fftwf_alignment_of((float*)in) == 0 &&
+                        fftwf_alignment_of((float*)out) == 0);
+  const int numThreads = planThreads;
+
+  // look for an existing plan
+  LOCKPLANS;
+  int found = findPlan(kind, rank, n, howmany, interleaved, inPlace, aligned, numThreads);
+  if (found >= 0) {
+    cache[found].users++;
+    *slot = (uint32_t)found;
+    const fftwf_plan p = cache[found].plan;
+    UNLOCKPLANS;
+    return p;
+  }
+  UNLOCKPLANS;
+
+  // plan without the cache locked, so that other sizes can still run
+  fftwf_plan p = makePlan(kind, rank, n, howmany, interleaved, inPlace, aligned, in, out);
+  if (!p) return NULL;
+
+  LOCKPLANS;
+
+  // another thread may have made the same plan meanwhile
+  found = findPlan(kind, rank, n, howmany, interleaved, inPlace, aligned, numThreads);
+  if (found >= 0) {
+    cache[found].users++;
+    *slot = (uint32_t)found;
+    const fftwf_plan q = cache[found].plan;
+    UNLOCKPLANS;
+    destroyPlan(p);
+    return q;
+  }
+
+  // store it, recycling the oldest idle slot if needed
+  fftwf_plan victim = NULL;
+  uint32_t s = numCached;
+  if (numCached < MAXCACHEDPLANS) {
+    numCached++;
+  } else {
+    s = MAXCACHEDPLANS;
+    for (uint32_t tries=0; tries<MAXCACHEDPLANS && s == MAXCACHEDPLANS; tries++) {
+      if (cache[nextVictim].users == 0) s = nextVictim;
+      nextVictim = (nextVictim+1) % MAXCACHEDPLANS;
+    }
+    // all busy, so this one is used once and thrown away
+    if (s == MAXCACHEDPLANS) {
+      *slot = s;
+      UNLOCKPLANS;
+      return p;
+    }
+    victim = cache[s].plan;
+  }
+  cache[s].kind = kind;
+  cache[s].rank = rank;
+  for (int d=0; d<MAXDIMS; d++) cache[s].n[d] = (d<rank) ? n[d] : 0;
+  cache[s].howmany = howmany;
+  cache[s].interleaved = interleaved;
+  cache[s].inPlace = inPlace;
+  cache[s].aligned = aligned;
+  cache[s].numThreads = numThreads;
+  cache[s].plan = p;
+  cache[s].users = 1;
+
+  *slot = s;
+  UNLOCKPLANS;
+  if (victim) destroyPlan(victim);
+  return p;
+}
+
+//
+// Done running a plan from getPlan
+//
+static void releasePlan (const fftwf_plan p, const uint32_t slot) {
+  if (slot < MAXCACHEDPLANS) {
+    LOCKPLANS;
+    cache[slot].users--;
+    UNLOCKPLANS;
+  } else {
+    destroyPlan(p);
+  }
+}
+
+//
+// Run a real-to-complex transform (in==out for in-place)
+//
+int executeR2C (const int rank, const ptrdiff_t* n, float* in, fftwf_complex* out) {
+  uint32_t slot;
+  const fftwf_plan p = getPlan(r2c,rank,n,1,FALSE,in,out,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft_r2c(p, in, out);
+  releasePlan(p, slot);
+  return(0);
+}
+
+//
+// Run a complex-to-real transform, which destroys its input
+//
+int executeC2R (const int rank, const ptrdiff_t* n, fftwf_complex* in, float* out) {
+  uint32_t slot;
+  const fftwf_plan p = getPlan(c2r,rank,n,1,FALSE,in,out,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft_c2r(p, in, out);
+  releasePlan(p, slot);
+  return(0);
+}
+
+//
+// Run a complex-to-complex transform, sign is FFTW_FORWARD or FFTW_BACKWARD
+//
+int executeC2C (const int rank, const ptrdiff_t* n, fftwf_complex* in, fftwf_complex* out,
+    const int sign) {
+  const PLANKIND kind = (sign == FFTW_FORWARD) ? c2cforward : c2cbackward;
+  uint32_t slot;
+  const fftwf_plan p = getPlan(kind,rank,n,1,FALSE,in,out,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft(p, in, out);
+  releasePlan(p, slot);
+  return(0);
+}
+
+//
+// Run howmany 1D complex transforms of length n in place, where the
+// elements of each are interleaved with the others (stride howmany)
+//
+int executeManyC2C (const ptrdiff_t n, const ptrdiff_t howmany, fftwf_complex* data, const int sign) {
+  const PLANKIND kind = (sign == FFTW_FORWARD) ? c2cforward : c2cbackward;
+  uint32_t slot;
+  const fftwf_plan p = getPlan(kind,1,&n,howmany,TRUE,data,data,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft(p, data, data);
+  releasePlan(p, slot);
+  return(0);
+}
+
+//
+// Run howmany real-to-complex transforms in place, one padded array
+// after another
+//
+int executeManyR2C (const int rank, const ptrdiff_t* n, const ptrdiff_t howmany, float* data) {
+  fftwf_complex* cdata = (fftwf_complex*)data;
+  uint32_t slot;
+  const fftwf_plan p = getPlan(r2c,rank,n,howmany,FALSE,data,cdata,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft_r2c(p, data, cdata);
+  releasePlan(p, slot);
+  return(0);
+}
+
+//
+// And back again
+//
+int executeManyC2R (const int rank, const ptrdiff_t* n, const ptrdiff_t howmany, float* data) {
+  fftwf_complex* cdata = (fftwf_complex*)data;
+  uint32_t slot;
+  const fftwf_plan p = getPlan(c2r,rank,n,howmany,FALSE,cdata,data,&slot);
+  if (!p) return(1);
+  fftwf_execute_dft_c2r(p, cdata, data);
+  releasePlan(p, slot);
+  return(0);
+}
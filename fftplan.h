@@ -0,0 +1,40 @@
+/*
+ * fftplan.h
+ *
+ * cached FFTW plans, shared by the 1D, 2D, and 3D transforms
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fftw3.h>
+
+// how many plans to keep around before recycling the oldest
+#define MAXCACHEDPLANS 32
+
+// the most scratch memory to measure a plan on, in bytes; bigger
+// transforms fall back to FFTW_ESTIMATE on their own arrays
+#define MAXPLANSCRATCH ((size_t)1 << 30)
+
+// sizes are 64-bit, plans come from the guru64 interface
+int executeR2C (const int, const ptrdiff_t*, float*, fftwf_complex*);
+int executeC2R (const int, const ptrdiff_t*, fftwf_complex*, float*);
+int executeC2C (const int, const ptrdiff_t*, fftwf_complex*, fftwf_complex*, const int);
+int executeManyC2C (const ptrdiff_t, const ptrdiff_t, fftwf_complex*, const int);
+int executeManyR2C (const int, const ptrdiff_t*, const ptrdiff_t, float*);
+int executeManyC2R (const int, const ptrdiff_t*, const ptrdiff_t, float*);
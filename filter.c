@@ -0,0 +1,380 @@
+/*
+ * filter.c - part of noisegen
+ *
+ * Shape a half-complex spectrum in one pass: every stage writes its
+ * multipliers for a row of bins into a small buffer, and only then is
+ * the row of the (possibly huge) spectrum read and written, once.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "filter.h"
+
+#define M_PI 3.14159265358979323846
+
+
+//
+// Start an empty filter over an array of the given real dimensions
+//
+void initFilter (FILTER* f, const uint8_t numDims, const size_t* n, const float scale) {
+  f->numDims = numDims;
+  for (uint8_t d=0; d<MAXDIMS; d++) f->n[d] = (d<numDims) ? n[d] : 1;
+  f->scale = scale;
+  f->numStages = 0;
+}
+
+//
+// Append a stage, they are applied in order
+//
+void addFilterStage (FILTER* f, FILTERFUNC apply, const void* ctx) {
+  if (f->numStages == MAXSTAGES) {
+    fprintf(stderr,"ERROR (addFilterStage): too many stages\n");
+    return;
+  }
+  f->stage[f->numStages].apply = apply;
+  f->stage[f->numStages].ctx = ctx;
+  f->numStages++;
+}
+
+//
+// Shape the rows in the box starting at lo with cnt entries per outer
+// axis, reading them from in and writing them to out, which may be the
+// same; both hold just those rows, stored contiguously; return 1 if a
+// thread had no room for its factors
+//
+static int filterRows (const void* in, void* out, const FILTER* f,
+    const size_t* lo, const size_t* cnt) {
+
+  const fftwf_complex* src = (const fftwf_complex*)in;
+  fftwf_complex* dest = (fftwf_complex*)out;
+  const uint8_t last = f->numDims-1;
+  const size_t nlast = f->n[last]/2+1;
+  size_t nrows = 1;
+  for (uint8_t d=0; d<last; d++) nrows *= cnt[d];
+
+  int failed = 0;
+  #pragma omp parallel
+  {
+    float* factors = (float*) malloc(nlast*sizeof(float));
+    if (!factors) {
+      #pragma omp atomic write
+      failed = 1;
+    }
+    size_t outer[MAXDIMS] = {0,0,0};
+
+    // every thread must still reach the loop, with or without rows
+    #pragma omp for schedule(static)
+    for (size_t r=0; r<nrows; r++) {
+      if (!factors) continue;
+
+      // where is this row?
+      size_t rem = r;
+      for (int d=last-1; d>=0; d--) {
+        outer[d] = lo[d] + rem % cnt[d];
+        rem /= cnt[d];
+      }
+
+      // gather the multipliers
+      for (size_t k=0; k<nlast; k++) factors[k] = f->scale;
+      for (uint32_t s=0; s<f->numStages; s++) {
+        f->stage[s].apply(f->stage[s].ctx, outer, nlast, factors);
+      }
+
+      // and apply them
+      const fftwf_complex* rowin = src + r*nlast;
+      fftwf_complex* row = dest + r*nlast;
+      for (size_t k=0; k<nlast; k++) {
+        row[k][0] = rowin[k][0] * factors[k];
+        row[k][1] = rowin[k][1] * factors[k];
+      }
+    }
+
+    free(factors);
+  }
+
+  if (failed) {
+    fprintf(stderr,"ERROR (filterRows): could not allocate %zu factors\n",nlast);
+    return(1);
+  }
+  return(0);
+}
+
+//
+// Multiply every bin of the r2c spectrum by the product of all stages;
+// return 1 if it could not be done
+//
+int applyFilter (void* inout, const FILTER* f) {
+  const size_t lo[MAXDIMS] = {0,0,0};
+  return filterRows(inout, inout, f, lo, f->n);
+}
+
+//
+// Same, but leave the input alone and put the result in out
+//
+int applyFilterFrom (const void* in, void* out, const FILTER* f) {
+  const size_t lo[MAXDIMS] = {0,0,0};
+  return filterRows(in, out, f, lo, f->n);
+}
+
+//
+// Same as applyFilter, but only for the rows whose outer indices are
+// in the box starting at lo with cnt entries per axis; the block holds
+// just those rows, stored contiguously
+//
+int applyFilterBlock (void* inout, const FILTER* f, const size_t* lo, const size_t* cnt) {
+  return filterRows(inout, inout, f, lo, cnt);
+}
+
+
+//
+// Prepare the power-law stage, exponent is on the power spectrum as
+// given on the command line; return 1 if its tables do not fit
+//
+int makeRadialFilter (RADIALFILTER* rf, const uint8_t numDims, const size_t* n,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent) {
+
+  // it's /2 because we need to take the sqrt of the distance from the origin!
+  const float thisexp = exponent / 2.0;
+
+  rf->numDims = numDims;
+  size_t maxDiag = 1;
+  for (uint8_t d=0; d<numDims-1; d++) {
+    rf->ksq[d] = makeWavenumberSquares(n[d]);
+    maxDiag += rf->ksq[d][n[d]/2];
+  }
+  // the last axis is only the non-negative half
+  rf->ksq[numDims-1] = NULL;
+  maxDiag += (n[numDims-1]/2)*(n[numDims-1]/2);
+
+  rf->table = makePowerLawTable(maxDiag, thisexp, longestWavelength, shortestWavelength);
+  if (!rf->table) {
+    for (uint8_t d=0; d<numDims-1; d++) free(rf->ksq[d]);
+    return(1);
+  }
+  return(0);
+}
+
+void freeRadialFilter (RADIALFILTER* rf) {
+  for (uint8_t d=0; d<rf->numDims-1; d++) free(rf->ksq[d]);
+  free(rf->table);
+}
+
+void radialFilterRow (const void* ctx, const size_t* outer, const size_t nlast, float* factors) {
+
+  const RADIALFILTER* rf = (const RADIALFILTER*)ctx;
+
+  size_t base = 1;
+  for (uint8_t d=0; d<rf->numDims-1; d++) base += rf->ksq[d][outer[d]];
+  const float* rowFactors = rf->table + base;
+
+  for (size_t k=0; k<nlast; k++) factors[k] *= rowFactors[k*k];
+}
+
+
+//
+// Angle in [0,pi/2] between the lines through the origin along two
+// vectors, given their cross (c) and dot (d) products; the arctangent
+// is a minimax polynomial good to about 1e-5 radians
+//
+static inline float lineAngle (const float c, const float d) {
+  const float a = fabsf(c);
+  const float b = fabsf(d);
+  // min and max by arithmetic, a select here would keep the division
+  // from being if-converted; the tiny term only matters at the origin
+  const float mx = 0.5f*(a + b + fabsf(a-b));
+  const float mn = 0.5f*(a + b - fabsf(a-b));
+  const float t = mn / (mx + 1.e-30f);
+  const float z = t*t;
+  float y = -1.172120e-2f;
+  y = y*z + 5.265332e-2f;
+  y = y*z - 1.1643287e-1f;
+  y = y*z + 1.9354346e-1f;
+  y = y*z - 3.3262347e-1f;
+  y = y*z + 9.9997726e-1f;
+  y *= t;
+  // reflect about pi/4 when the cross product is the larger one,
+  // written without a select so that the callers still vectorize
+  const float flip = (float)(a > b);
+  return y + flip*(0.5f*(float)M_PI - 2.0f*y);
+}
+
+// bins per inner block in the plane kernels
+#define PLANEBLOCK 64
+
+//
+// Prepare the preference-plane stage: in 2D the streak for plane
+// vector (x,y) runs along (y, ar*x) in index space, where ar=nx/ny;
+// in 3D the vector is the plane normal in physical space, and the
+// wavevectors get scaled by 1/n per axis to match; planes with a
+// zero vector have no direction and are dropped
+//
+void makePlaneFilter (PLANEFILTER* pf, const uint8_t numDims, const size_t* n,
+    const uint32_t numPlanes, const PLANE* pp) {
+
+  pf->numDims = numDims;
+  for (uint8_t d=0; d<MAXDIMS; d++) pf->n[d] = (d<numDims) ? n[d] : 1;
+  pf->numPlanes = 0;
+
+  const float ar = (float)n[0]/(float)n[1];
+
+  for (uint32_t ip=0; ip<numPlanes && ip<MAXPLANES; ip++) {
+    float v[MAXDIMS];
+    if (numDims == 2) {
+      v[0] = pp[ip].vec[1];
+      v[1] = ar*pp[ip].vec[0];
+    } else {
+      for (uint8_t d=0; d<numDims; d++) v[d] = pp[ip].vec[d];
+    }
+    float len = 0.0;
+    for (uint8_t d=0; d<numDims; d++) len += v[d]*v[d];
+    len = sqrt(len);
+    if (len == 0.0 || pp[ip].width == 0.0) continue;
+
+    const uint32_t np = pf->numPlanes;
+    for (uint8_t d=0; d<numDims; d++) pf->dir[d][np] = v[d]/len;
+    pf->strength[np] = pp[ip].strength;
+    pf->invWidth[np] = 1.0/pp[ip].width;
+    pf->numPlanes++;
+  }
+}
+
+//
+// 2D streaks: boost bins whose direction is near each plane's line
+//
+void planeFilterRow2D (const void* ctx, const size_t* outer, const size_t nlast, float* factors) {
+
+  const PLANEFILTER* pf = (const PLANEFILTER*)ctx;
+  const size_t nx = pf->n[0];
+  const size_t i = outer[0];
+
+  // the row's wavevector is (j, ki), with the same fold as before
+  const float ki = (i < nx/2) ? -(float)i : (float)(nx-i);
+
+  for (size_t j0=0; j0<nlast; j0+=PLANEBLOCK) {
+    // int counters here, since 64-bit integers do not convert to
+    // floats in vector registers
+    const int cnt = (nlast-j0 < PLANEBLOCK) ? (int)(nlast-j0) : PLANEBLOCK;
+    const float j0f = (float)j0;
+    float acc[PLANEBLOCK];
+    for (int jj=0; jj<cnt; jj++) acc[jj] = 1.0;
+
+    for (uint32_t ip=0; ip<pf->numPlanes; ip++) {
+      const float ux = pf->dir[0][ip];
+      const float uy = pf->dir[1][ip];
+      const float s = pf->strength[ip];
+      const float iw = pf->invWidth[ip];
+      #pragma omp simd
+      for (int jj=0; jj<cnt; jj++) {
+        const float kj = j0f + (float)jj;
+        const float ang = lineAngle(kj*uy - ki*ux, kj*ux + ki*uy);
+        acc[jj] += s * fmaxf(0.0f, 1.0f - ang*iw);
+      }
+    }
+
+    // the dc term is never touched
+    if (i == 0 && j0 == 0) acc[0] = 1.0;
+
+    for (int jj=0; jj<cnt; jj++) factors[j0+jj] *= acc[jj];
+  }
+}
+
+//
+// 3D planes: boost bins whose wavevector is near each plane's normal
+//
+void planeFilterRow3D (const void* ctx, const size_t* outer, const size_t nlast, float* factors) {
+
+  const PLANEFILTER* pf = (const PLANEFILTER*)ctx;
+  const size_t nx = pf->n[0];
+  const size_t ny = pf->n[1];
+  const size_t i = outer[0];
+  const size_t j = outer[1];
+
+  // signed wavenumbers, in cycles per voxel
+  const float kx = ((i <= nx/2) ? (float)i : (float)i-(float)nx) / (float)nx;
+  const float ky = ((j <= ny/2) ? (float)j : (float)j-(float)ny) / (float)ny;
+  const float dkz = 1.0 / (float)pf->n[2];
+
+  for (size_t k0=0; k0<nlast; k0+=PLANEBLOCK) {
+    // int counters here, since 64-bit integers do not convert to
+    // floats in vector registers
+    const int cnt = (nlast-k0 < PLANEBLOCK) ? (int)(nlast-k0) : PLANEBLOCK;
+    const float k0f = (float)k0;
+    float acc[PLANEBLOCK];
+    for (int kk=0; kk<cnt; kk++) acc[kk] = 1.0;
+
+    for (uint32_t ip=0; ip<pf->numPlanes; ip++) {
+      const float ux = pf->dir[0][ip];
+      const float uy = pf->dir[1][ip];
+      const float uz = pf->dir[2][ip];
+      const float s = pf->strength[ip];
+      const float iw = pf->invWidth[ip];
+      // the parts of k dot u and k cross u that do not change along the row
+      const float d0 = kx*ux + ky*uy;
+      const float cz = kx*uy - ky*ux;
+      #pragma omp simd
+      for (int kk=0; kk<cnt; kk++) {
+        const float kz = dkz*(k0f + (float)kk);
+        const float cx = ky*uz - kz*uy;
+        const float cy = kz*ux - kx*uz;
+        const float cross = sqrtf(cx*cx + cy*cy + cz*cz);
+        const float ang = lineAngle(cross, d0 + kz*uz);
+        acc[kk] += s * fmaxf(0.0f, 1.0f - ang*iw);
+      }
+    }
+
+    // the dc term is never touched
+    if (i == 0 && j == 0 && k0 == 0) acc[0] = 1.0;
+
+    for (int kk=0; kk<cnt; kk++) factors[k0+kk] *= acc[kk];
+  }
+}
+
+
+//
+// Put the radial and plane stages together; the stages point back
+// into nf, so it must stay put while the filter is in use; return 1,
+// with nothing left to free, if it could not be made
+//
+int makeNoiseFilter (NOISEFILTER* nf, const uint8_t numDims, const size_t* n,
+    const float scale,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp) {
+
+  initFilter(&nf->filter, numDims, n, scale);
+
+  if (makeRadialFilter(&nf->radial, numDims, n, longestWavelength, shortestWavelength,
+                       exponent)) return(1);
+  addFilterStage(&nf->filter, radialFilterRow, &nf->radial);
+
+  if (numPlanes > 0) {
+    makePlaneFilter(&nf->planes, numDims, n, numPlanes, pp);
+    addFilterStage(&nf->filter, (numDims == 2) ? planeFilterRow2D : planeFilterRow3D,
+                   &nf->planes);
+  }
+  return(0);
+}
+
+void freeNoiseFilter (NOISEFILTER* nf) {
+  freeRadialFilter(&nf->radial);
+}
@@ -0,0 +1,96 @@
+/*
+ * filter.h
+ *
+ * a spectral filter built from stages, each of which provides a
+ * multiplier for every frequency bin, applied in one sweep
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "noisegen.h"
+#include "planes.h"
+
+#define MAXSTAGES 8
+
+//
+// A stage multiplies its factors into one row of bins along the last
+// (half-complex) axis; outer holds the row's index along the others
+//
+typedef void (*FILTERFUNC)(const void*, const size_t*, const size_t, float*);
+
+typedef struct filterStageType {
+  FILTERFUNC apply;
+  const void* ctx;
+} FILTERSTAGE;
+
+typedef struct spectralFilterType {
+  uint8_t numDims;
+  size_t n[MAXDIMS];
+  // constant multiplier for all bins, usually the 1/N of the inverse FFT
+  float scale;
+  uint32_t numStages;
+  FILTERSTAGE stage[MAXSTAGES];
+} FILTER;
+
+// power law in |k| with band-pass cutoffs folded in
+typedef struct radialFilterType {
+  uint8_t numDims;
+  size_t* ksq[MAXDIMS];
+  float* table;
+} RADIALFILTER;
+
+// preference planes, accumulated; directions are unit length and
+// stored one axis per array so the per-bin loops vectorize
+typedef struct planeFilterType {
+  uint8_t numDims;
+  size_t n[MAXDIMS];
+  uint32_t numPlanes;
+  float dir[MAXDIMS][MAXPLANES];
+  float strength[MAXPLANES];
+  float invWidth[MAXPLANES];
+} PLANEFILTER;
+
+// the usual noise filter: power law with band-pass, then any planes
+typedef struct noiseFilterType {
+  FILTER filter;
+  RADIALFILTER radial;
+  PLANEFILTER planes;
+} NOISEFILTER;
+
+void initFilter (FILTER*, const uint8_t, const size_t*, const float);
+void addFilterStage (FILTER*, FILTERFUNC, const void*);
+int applyFilter (void*, const FILTER*);
+int applyFilterFrom (const void*, void*, const FILTER*);
+int applyFilterBlock (void*, const FILTER*, const size_t*, const size_t*);
+
+int makeRadialFilter (RADIALFILTER*, const uint8_t, const size_t*,
+                      const float, const float, const float);
+void freeRadialFilter (RADIALFILTER*);
+void radialFilterRow (const void*, const size_t*, const size_t, float*);
+
+void makePlaneFilter (PLANEFILTER*, const uint8_t, const size_t*, const uint32_t, const PLANE*);
+void planeFilterRow2D (const void*, const size_t*, const size_t, float*);
+void planeFilterRow3D (const void*, const size_t*, const size_t, float*);
+
+int makeNoiseFilter (NOISEFILTER*, const uint8_t, const size_t*, const float,
+                     const float, const float, const float,
+                     const uint32_t, const PLANE*);
+void freeNoiseFilter (NOISEFILTER*);
@@ -0,0 +1,257 @@
+/*
+ * iir1d.c - part of noisegen
+ *
+ * Make 1D colored noise sample by sample, with no block latency, using
+ * recursive filters whose cost per sample does not depend on the length.
+ * The amplitude exponent is split into a whole part, made with leaky
+ * integrators (falling) or first differences (rising), and a remainder
+ * of at most one half, made either with the Voss-McCartney generator
+ * (exactly -1/2, which is 1/f power) or with a cascade of first-order
+ * pole-zero sections spaced evenly in log frequency. Independent
+ * channels are interleaved so that every stage runs in SIMD over them.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "output1d.h"
+#include "iir1d.h"
+
+#define M_PI 3.14159265358979323846
+
+typedef struct iirNoiseType {
+  size_t channels;
+  // Voss-McCartney rows and their running sum, if any
+  int numRows;
+  uint64_t count;
+  float* rows;
+  float* rowSum;
+  // pole-zero sections, with the last input and output of each
+  int numSections;
+  float pole[MAXIIRSECTIONS];
+  float zero[MAXIIRSECTIONS];
+  float* lastIn;
+  float* lastOut;
+  // integrators (steps<0) or differences (steps>0), and their state
+  int steps;
+  float leak;
+  float* held;
+  // scale on the white input
+  float gain;
+} IIRNOISE;
+
+
+//
+// |1 - a e^(-i w)|, the gain of one first-order term
+//
+static double termGain (const double a, const double w) {
+  return sqrt(1.0 - 2.0*a*cos(w) + a*a);
+}
+
+//
+// Lay out the stages for amplitude ~ f^exponent from the Nyquist
+// frequency down to 1/longest cycles per sample, flat below that
+//
+static void designIIR (IIRNOISE* f, const size_t channels,
+    const size_t longest, const float exponent) {
+
+  const double flo = 1.0 / (double)longest;
+  const double wlo = 2.0*M_PI*flo;
+  f->channels = channels;
+  f->count = 0;
+
+  f->steps = (int)floor(exponent + 0.5);
+  const double frac = exponent - (double)f->steps;
+  f->leak = exp(-wlo);
+
+  f->numRows = 0;
+  f->numSections = 0;
+  if (fabs(frac + 0.5) < 1.e-6) {
+    // row r changes every 2^(r+1) samples, so enough rows to reach flo
+    f->numRows = (int)ceil(log2((double)longest));
+    if (f->numRows < 1) f->numRows = 1;
+    if (f->numRows > MAXVOSSROWS) f->numRows = MAXVOSSROWS;
+
+  } else if (fabs(frac) > 1.e-6) {
+    // two sections per decade; within each, the slope is -1 or +1 for
+    // a fraction |frac| of the interval, and flat for the rest
+    f->numSections = (int)ceil(2.0*log10(0.5/flo));
+    if (f->numSections < 1) f->numSections = 1;
+    if (f->numSections > MAXIIRSECTIONS) f->numSections = MAXIIRSECTIONS;
+    const double ratio = pow(0.5/flo, 1.0/(double)f->numSections);
+    for (int s=0; s<f->numSections; s++) {
+      const double f1 = flo * pow(ratio, (double)s);
+      const double f2 = f1 * pow(ratio, fabs(frac));
+      f->pole[s] = (float)exp(-2.0*M_PI*((frac < 0.0) ? f1 : f2));
+      f->zero[s] = (float)exp(-2.0*M_PI*((frac < 0.0) ? f2 : f1));
+    }
+  }
+
+  // unit gain at the longest wavelength, as (1+k)^exponent has at k=0;
+  // the Voss-McCartney rows are scaled by their count instead
+  double g = 1.0;
+  for (int s=0; s<f->numSections; s++) {
+    g *= termGain(f->zero[s], wlo) / termGain(f->pole[s], wlo);
+  }
+  for (int j=0; j<abs(f->steps); j++) {
+    g *= (f->steps < 0) ? 1.0/termGain(f->leak, wlo) : termGain(1.0, wlo);
+  }
+  f->gain = (float)(1.0/g);
+  if (f->numRows > 0) f->gain /= sqrt((float)(f->numRows+1));
+
+  f->rows = (float*) calloc((size_t)f->numRows*channels + 1, sizeof(float));
+  f->rowSum = (float*) calloc(channels, sizeof(float));
+  f->lastIn = (float*) calloc((size_t)f->numSections*channels + 1, sizeof(float));
+  f->lastOut = (float*) calloc((size_t)f->numSections*channels + 1, sizeof(float));
+  f->held = (float*) calloc((size_t)abs(f->steps)*channels + 1, sizeof(float));
+}
+
+static void freeIIR (IIRNOISE* f) {
+  free(f->rows);
+  free(f->rowSum);
+  free(f->lastIn);
+  free(f->lastOut);
+  free(f->held);
+}
+
+
+//
+// Run n samples of every channel through the stages; white holds one
+// frame of input per sample, and a second frame for Voss-McCartney
+//
+static void runIIR (IIRNOISE* f, const float* white, float* out, const size_t n) {
+
+  const size_t nc = f->channels;
+  const size_t draws = (f->numRows > 0) ? 2 : 1;
+  const float g = f->gain;
+
+  for (size_t t=0; t<n; t++) {
+    const float* w = white + t*draws*nc;
+    float* y = out + t*nc;
+
+    if (f->numRows > 0) {
+      // the trailing zeros of the count pick the row that changes
+      f->count++;
+      int r = 0;
+      while (r < f->numRows && ((f->count >> r) & 1) == 0) r++;
+      if (r < f->numRows) {
+        float* row = f->rows + r*nc;
+        const float* u = w + nc;
+        #pragma omp simd
+        for (size_t c=0; c<nc; c++) {
+          f->rowSum[c] += u[c] - row[c];
+          row[c] = u[c];
+        }
+      }
+      #pragma omp simd
+      for (size_t c=0; c<nc; c++) y[c] = g*(f->rowSum[c] + w[c]);
+    } else {
+      #pragma omp simd
+      for (size_t c=0; c<nc; c++) y[c] = g*w[c];
+    }
+
+    for (int s=0; s<f->numSections; s++) {
+      const float p = f->pole[s];
+      const float z = f->zero[s];
+      float* xs = f->lastIn + s*nc;
+      float* ys = f->lastOut + s*nc;
+      #pragma omp simd
+      for (size_t c=0; c<nc; c++) {
+        const float x = y[c];
+        const float v = p*ys[c] + x - z*xs[c];
+        xs[c] = x;
+        ys[c] = v;
+        y[c] = v;
+      }
+    }
+
+    for (int j=0; j<abs(f->steps); j++) {
+      float* h = f->held + j*nc;
+      if (f->steps < 0) {
+        const float leak = f->leak;
+        #pragma omp simd
+        for (size_t c=0; c<nc; c++) {
+          h[c] = leak*h[c] + y[c];
+          y[c] = h[c];
+        }
+      } else {
+        #pragma omp simd
+        for (size_t c=0; c<nc; c++) {
+          const float x = y[c];
+          y[c] = x - h[c];
+          h[c] = x;
+        }
+      }
+    }
+  }
+}
+
+
+/*
+ * Generate and write total samples of each of channels channels, or
+ * never stop if total is zero
+ */
+int makeNoiseIIR1D (const size_t total, const size_t block, const size_t channels,
+    const size_t longest,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored, const float exponent,
+    const OUTFF outtype, char* outfile) {
+
+  FILE* ofh = beginData1D(outtype, outfile);
+  if (!ofh) return(1);
+
+  IIRNOISE f;
+  designIIR(&f, channels, longest, colored ? exponent : 0.0);
+
+  const size_t draws = (f.numRows > 0) ? 2 : 1;
+  float* white = (float*) malloc(draws*block*channels*sizeof(float));
+  float* out = (float*) malloc(block*channels*sizeof(float));
+
+  // white noise is counter-based, so the stream can pick up anywhere;
+  // the filters first run for a few of the longest wavelengths, so
+  // that the output starts out stationary
+  size_t next = 0;
+  const size_t warmup = colored ? 4*longest : 0;
+  size_t first = 0;
+  int failed = 0;
+  while (total == 0 || first < warmup+total) {
+    size_t nb = block;
+    if (first < warmup && warmup-first < nb) nb = warmup-first;
+    if (total > 0 && warmup+total-first < nb) nb = warmup+total-first;
+
+    const size_t nw = draws*nb*channels;
+    if (gaussian) getRandomGaussianAt(generator,randSeed,next,white,nw,0.0,1.0);
+    else getRandomUniformAt(generator,randSeed,next,white,nw,-1.0,1.0);
+    next += nw;
+
+    runIIR(&f, white, out, nb);
+    if (first >= warmup && writeBlock1D(outtype, ofh, out, first-warmup, nb, channels)) {
+      failed = 1;
+      break;
+    }
+    first += nb;
+  }
+
+  if (endData1D(ofh, outfile)) failed = 1;
+  freeIIR(&f);
+  free(white);
+  free(out);
+
+  return(failed);
+}
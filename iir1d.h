@@ -0,0 +1,36 @@
+/*
+ * iir1d.h - part of noisegen
+ *
+ * 1-D colored noise made sample by sample with recursive filters
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+#include "output.h"
+#include "rng.hpp"
+
+// most pole-zero sections, and most Voss-McCartney rows
+#define MAXIIRSECTIONS 32
+#define MAXVOSSROWS 32
+
+int makeNoiseIIR1D (const size_t, const size_t, const size_t, const size_t,
+                    const RNG, const int, const BOOL, const BOOL, const float,
+                    const OUTFF, char*);
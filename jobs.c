@@ -0,0 +1,436 @@
+/*
+ * jobs.c - part of noisegen
+ *
+ * Run a batch of independent jobs of mixed dimensions, sizes, colors,
+ * and formats, read from a manifest with one request per line, in
+ * the same words as -serve takes. Every line is checked before any
+ * work starts. The big jobs then run one at a time with all of the
+ * threads inside each transform; the rest are sorted by shape, dealt
+ * out in contiguous runs of about equal work to one worker per thread,
+ * and run single-threaded. A worker that runs out steals the back half
+ * of another's run, so the cores stay busy to the end, and runs of the
+ * same shape stay together so that each worker's context reuses its
+ * filter. FFTW plans are shared by all workers through the plan cache.
+ *
+ * link with -lfftw3f -lpthread
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fftw3.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "fft.h"
+#include "libnoisegen.h"
+#include "request.h"
+#include "jobs.h"
+
+
+//
+// One line of the manifest, ready to run
+//
+typedef struct jobType {
+  NGPARAMS p;
+  uint8_t numDims;
+  size_t ntotal;
+  // the line, split into words in place, which outfile points into
+  char* text;
+  char* outfile;
+  size_t line;
+} JOB;
+
+//
+// Biggest first, then grouped by shape and filter, then in file order
+//
+static int compareJobs (const void* a, const void* b) {
+  const JOB* ja = *(const JOB* const*)a;
+  const JOB* jb = *(const JOB* const*)b;
+  if (ja->ntotal != jb->ntotal) return (ja->ntotal > jb->ntotal) ? -1 : 1;
+  if (ja->numDims != jb->numDims) return (ja->numDims < jb->numDims) ? -1 : 1;
+  for (uint8_t d=0; d<MAXDIMS; d++) {
+    if (ja->p.n[d] != jb->p.n[d]) return (ja->p.n[d] < jb->p.n[d]) ? -1 : 1;
+  }
+  if (ja->p.colored != jb->p.colored) return ja->p.colored ? -1 : 1;
+  if (ja->p.exponent != jb->p.exponent) return (ja->p.exponent < jb->p.exponent) ? -1 : 1;
+  return (ja->line < jb->line) ? -1 : 1;
+}
+
+
+//
+// Read and check every line; return the jobs, or NULL if any line is
+// bad or there are none
+//
+static JOB* readJobs (const char* jobFile, const int numThreads, size_t* numJobs) {
+
+  FILE* ifh = fopen(jobFile,"r");
+  if (!ifh) {
+    fprintf(stderr,"ERROR (runJobs): could not open %s\n",jobFile);
+    return NULL;
+  }
+
+  JOB* jobs = NULL;
+  size_t capacity = 0;
+  size_t nj = 0;
+  size_t numBad = 0;
+  size_t numSwitched = 0;
+  size_t line = 0;
+  char buf[JOBSMAXLINE+2];
+
+  while (fgets(buf, JOBSMAXLINE+2, ifh)) {
+    line++;
+    if (strlen(buf) > JOBSMAXLINE && buf[JOBSMAXLINE] != '\n') {
+      fprintf(stderr,"ERROR (runJobs): line %zu of %s is too long\n",line,jobFile);
+      numBad++;
+      // skip the rest of it
+      int c;
+      while ((c = fgetc(ifh)) != EOF && c != '\n') ;
+      continue;
+    }
+
+    // everything after a # is a comment
+    char* hash = strchr(buf, '#');
+    if (hash) *hash = '\0';
+
+    char* text = (char*) malloc(strlen(buf)+1);
+    if (!text) {
+      fprintf(stderr,"ERROR (runJobs): could not allocate line %zu of %s\n",line,jobFile);
+      numBad++;
+      break;
+    }
+    strcpy(text, buf);
+    char* argv[MAXREQUESTWORDS];
+    const int argc = splitRequest(text, argv);
+    if (argc == 0) {
+      free(text);
+      continue;
+    }
+
+    JOB j;
+    PLANE planes[MAXPLANES];
+    char why[256];
+    BOOL switched = FALSE;
+    BOOL bad = TRUE;
+    if (argc < 0) {
+      sprintf(why,"too many words");
+    } else if (parseRequest(argc, argv, numThreads, &j.p, &j.numDims, planes, &j.outfile,
+                            why, &switched) == 0) {
+      if (!j.outfile) sprintf(why,"every job needs -o");
+      else bad = FALSE;
+    }
+    if (bad) {
+      fprintf(stderr,"ERROR (runJobs): line %zu of %s: %s\n",line,jobFile,why);
+      numBad++;
+      free(text);
+      continue;
+    }
+
+    // keep only the planes this job has
+    j.p.planes = NULL;
+    if (j.p.numPlanes > 0) {
+      PLANE* pp = (PLANE*) malloc(j.p.numPlanes*sizeof(PLANE));
+      if (!pp) {
+        fprintf(stderr,"ERROR (runJobs): could not allocate line %zu of %s\n",line,jobFile);
+        numBad++;
+        free(text);
+        break;
+      }
+      memcpy(pp, planes, j.p.numPlanes*sizeof(PLANE));
+      j.p.planes = pp;
+    }
+    // every job makes what a run of its own would
+    if (switched) numSwitched++;
+    j.ntotal = 1;
+    for (uint8_t d=0; d<j.numDims; d++) j.ntotal *= j.p.n[d];
+    j.text = text;
+    j.line = line;
+
+    if (nj == capacity) {
+      const size_t grown = (capacity > 0) ? 2*capacity : 64;
+      JOB* more = (JOB*) realloc(jobs, grown*sizeof(JOB));
+      if (!more) {
+        fprintf(stderr,"ERROR (runJobs): could not allocate %zu jobs\n",grown);
+        numBad++;
+        free(text);
+        free((PLANE*)j.p.planes);
+        break;
+      }
+      jobs = more;
+      capacity = grown;
+    }
+    jobs[nj++] = j;
+  }
+  fclose(ifh);
+
+  if (numBad > 0 || nj == 0) {
+    if (nj == 0 && numBad == 0) fprintf(stderr,"ERROR (runJobs): no jobs in %s\n",jobFile);
+    for (size_t i=0; i<nj; i++) {
+      free(jobs[i].text);
+      free((PLANE*)jobs[i].p.planes);
+    }
+    free(jobs);
+    return NULL;
+  }
+
+  if (numSwitched > 0) {
+    char which[64];
+    sprintf(which,"%zu jobs",numSwitched);
+    noteSwitchedGenerator(which);
+  }
+
+  *numJobs = nj;
+  return jobs;
+}
+
+
+//
+// Make one job and write it, growing the answer buffer if needed
+//
+static int runJob (const JOB* j, NGCONTEXT* ctx, float** out, size_t* outSize) {
+
+  if (*outSize < j->ntotal) {
+    if (*out) fftwf_free(*out);
+    *out = (float*) fftwf_malloc(j->ntotal*sizeof(float));
+    *outSize = *out ? j->ntotal : 0;
+  }
+
+  int failed = (*out == NULL);
+  if (!failed) {
+    if (j->numDims == 1) failed = ng_generate_1d(ctx, &j->p, *out);
+    else if (j->numDims == 2) failed = ng_generate_2d(ctx, &j->p, *out);
+    else failed = ng_generate_3d(ctx, &j->p, *out);
+  }
+  if (failed) {
+    fprintf(stderr,"ERROR (runJobs): could not make the job on line %zu\n",j->line);
+    return(1);
+  }
+
+  if (writeRequest(j->numDims, j->p.n, *out, j->outfile)) {
+    fprintf(stderr,"ERROR (runJobs): could not write the job on line %zu\n",j->line);
+    return(1);
+  }
+  return(0);
+}
+
+
+#ifndef _WIN32
+//
+// The jobs still to run on one worker are order[head..tail)
+//
+typedef struct jobDequeType {
+  size_t head;
+  size_t tail;
+  pthread_mutex_t lock;
+} JOBDEQUE;
+
+typedef struct jobPoolType {
+  JOB** order;
+  JOBDEQUE* deque;
+  int numWorkers;
+  size_t numFailed;
+  pthread_mutex_t failLock;
+} JOBPOOL;
+
+typedef struct jobWorkerType {
+  JOBPOOL* pool;
+  int id;
+  pthread_t thread;
+} JOBWORKER;
+
+
+//
+// The next of this worker's own jobs, from the front
+//
+static JOB* takeJob (JOBPOOL* pool, const int id) {
+  JOBDEQUE* q = &pool->deque[id];
+  JOB* j = NULL;
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail) j = pool->order[q->head++];
+  pthread_mutex_unlock(&q->lock);
+  return j;
+}
+
+//
+// Move the back half of the first other worker's jobs that has any
+// over to this one; return FALSE if nobody has any left
+//
+static BOOL stealJobs (JOBPOOL* pool, const int id) {
+  for (int k=1; k<pool->numWorkers; k++) {
+    JOBDEQUE* v = &pool->deque[(id+k) % pool->numWorkers];
+    pthread_mutex_lock(&v->lock);
+    const size_t left = v->tail - v->head;
+    if (left == 0) {
+      pthread_mutex_unlock(&v->lock);
+      continue;
+    }
+    const size_t tail = v->tail;
+    v->tail -= (left+1)/2;
+    const size_t head = v->tail;
+    pthread_mutex_unlock(&v->lock);
+
+    JOBDEQUE* q = &pool->deque[id];
+    pthread_mutex_lock(&q->lock);
+    q->head = head;
+    q->tail = tail;
+    pthread_mutex_unlock(&q->lock);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static void* jobWorker (void* arg) {
+
+  JOBWORKER* w = (JOBWORKER*)arg;
+  JOBPOOL* pool = w->pool;
+#ifdef _OPENMP
+  // the workers are the parallelism here
+  omp_set_num_threads(1);
+#endif
+  NGCONTEXT* ctx = ng_create();
+  float* out = NULL;
+  size_t outSize = 0;
+  size_t numFailed = 0;
+
+  while (TRUE) {
+    JOB* j = takeJob(pool, w->id);
+    if (!j) {
+      if (stealJobs(pool, w->id)) continue;
+      break;
+    }
+    numFailed += runJob(j, ctx, &out, &outSize);
+  }
+
+  pthread_mutex_lock(&pool->failLock);
+  pool->numFailed += numFailed;
+  pthread_mutex_unlock(&pool->failLock);
+
+  if (out) fftwf_free(out);
+  ng_destroy(ctx);
+  return NULL;
+}
+
+//
+// Run order[0..count) with numWorkers single-threaded workers; return
+// the number that failed
+//
+static size_t runPool (JOB** order, const size_t count, const int numWorkers) {
+
+  JOBPOOL pool;
+  pool.order = order;
+  pool.numWorkers = numWorkers;
+  pool.numFailed = 0;
+  pthread_mutex_init(&pool.failLock, NULL);
+  pool.deque = (JOBDEQUE*) malloc(numWorkers*sizeof(JOBDEQUE));
+
+  // deal out contiguous runs of about the same number of points
+  size_t work = 0;
+  for (size_t i=0; i<count; i++) work += order[i]->ntotal;
+  size_t next = 0;
+  size_t done = 0;
+  for (int w=0; w<numWorkers; w++) {
+    const size_t share = (w == numWorkers-1) ? work : (size_t)((double)work*(w+1)/numWorkers);
+    pool.deque[w].head = next;
+    while (next < count && (w == numWorkers-1 || done < share)) done += order[next++]->ntotal;
+    pool.deque[w].tail = next;
+    pthread_mutex_init(&pool.deque[w].lock, NULL);
+  }
+
+  JOBWORKER* workers = (JOBWORKER*) malloc(numWorkers*sizeof(JOBWORKER));
+  for (int w=0; w<numWorkers; w++) {
+    workers[w].pool = &pool;
+    workers[w].id = w;
+    pthread_create(&workers[w].thread, NULL, jobWorker, &workers[w]);
+  }
+  for (int w=0; w<numWorkers; w++) pthread_join(workers[w].thread, NULL);
+
+  for (int w=0; w<numWorkers; w++) pthread_mutex_destroy(&pool.deque[w].lock);
+  pthread_mutex_destroy(&pool.failLock);
+  free(pool.deque);
+  free(workers);
+
+  return pool.numFailed;
+}
+#endif
+
+
+/*
+ * Run every job in jobFile with numThreads threads; the whole file is
+ * checked first, and one failed job does not stop the others
+ */
+int runJobs (const char* jobFile, const int numThreads) {
+
+  size_t numJobs = 0;
+  JOB* jobs = readJobs(jobFile, numThreads, &numJobs);
+  if (!jobs) return(1);
+
+  JOB** order = (JOB**) malloc(numJobs*sizeof(JOB*));
+  for (size_t i=0; i<numJobs; i++) order[i] = &jobs[i];
+  qsort(order, numJobs, sizeof(JOB*), compareJobs);
+
+  // the big ones first, each with every thread
+  size_t numBig = 0;
+  if (numThreads > 1) {
+    while (numBig < numJobs && order[numBig]->ntotal >= JOBSBIGPOINTS) numBig++;
+  }
+  size_t numFailed = 0;
+  if (numBig > 0) {
+    setFFTThreads(numThreads);
+    NGCONTEXT* ctx = ng_create();
+    float* out = NULL;
+    size_t outSize = 0;
+    for (size_t i=0; i<numBig; i++) numFailed += runJob(order[i], ctx, &out, &outSize);
+    if (out) fftwf_free(out);
+    ng_destroy(ctx);
+  }
+
+  // then the rest side by side, one thread each
+  const size_t numSmall = numJobs - numBig;
+  if (numSmall > 0) {
+    setFFTThreads(1);
+#ifndef _WIN32
+    const int nw = (numThreads > 1 && numSmall > 1) ?
+                   (((size_t)numThreads < numSmall) ? numThreads : (int)numSmall) : 1;
+    numFailed += runPool(order+numBig, numSmall, nw);
+#else
+    NGCONTEXT* ctx = ng_create();
+    float* out = NULL;
+    size_t outSize = 0;
+    for (size_t i=numBig; i<numJobs; i++) numFailed += runJob(order[i], ctx, &out, &outSize);
+    if (out) fftwf_free(out);
+    ng_destroy(ctx);
+#endif
+  }
+
+  fprintf(stderr,"Ran %zu jobs from %s, %zu big and %zu small",numJobs,jobFile,numBig,numSmall);
+  if (numFailed > 0) fprintf(stderr,", of which %zu failed",numFailed);
+  fprintf(stderr,"\n");
+
+  for (size_t i=0; i<numJobs; i++) {
+    free(jobs[i].text);
+    free((PLANE*)jobs[i].p.planes);
+  }
+  free(jobs);
+  free(order);
+
+  return (numFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * jobs.h - part of noisegen
+ *
+ * Run a manifest of unrelated noise jobs, one set of options per line,
+ * over every core
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+
+// longest line in a manifest, and the size from which a job gets all
+// of the threads to itself instead of one
+#define JOBSMAXLINE 4096
+#define JOBSBIGPOINTS ((size_t)1<<22)
+
+int runJobs (const char*, const int);
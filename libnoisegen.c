@@ -0,0 +1,324 @@
+/*
+ * libnoisegen.c - part of noisegen
+ *
+ * The library entry points. A context keeps the padded work array and
+ * the noise filter from one call to the next, so that repeated calls
+ * of the same size allocate nothing and rebuild nothing; the FFTW
+ * plans come from the plan cache in fftplan.c, which every context
+ * shares, so each size is planned once per process. Results go straight
+ * into the caller's array: white noise is drawn there, and colored
+ * noise comes out of an out-of-place inverse transform into it. The
+ * command line makes its still fields here too, in place in the
+ * context, with hooks to save the spectrum or cut mipmaps from it.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "filter.h"
+#include "spectrum.h"
+#include "libnoisegen.h"
+
+struct ngContextType {
+  // padded in-place array for the spectrum, grown when needed
+  float* work;
+  size_t workSize;
+  // the filter of the last colored call, and what it was made for
+  BOOL haveFilter;
+  NOISEFILTER filter;
+  uint8_t numDims;
+  size_t n[MAXDIMS];
+  float exponent;
+  float longestWavelength;
+  float shortestWavelength;
+  uint32_t numPlanes;
+  PLANE planes[MAXPLANES];
+};
+
+
+/*
+ * Make an empty context; it takes memory only when first used
+ */
+NGCONTEXT* ng_create (void) {
+  NGCONTEXT* ctx = (NGCONTEXT*) calloc(1, sizeof(NGCONTEXT));
+  if (!ctx) fprintf(stderr,"ERROR (ng_create): could not allocate a context\n");
+  return ctx;
+}
+
+void ng_destroy (NGCONTEXT* ctx) {
+  if (!ctx) return;
+  if (ctx->haveFilter) freeNoiseFilter(&ctx->filter);
+  if (ctx->work) fftwf_free(ctx->work);
+  free(ctx);
+}
+
+/*
+ * Uniform white noise, 256 on a side, with the command line's seed
+ */
+void ng_default_params (NGPARAMS* p) {
+  memset(p, 0, sizeof(NGPARAMS));
+  for (uint8_t d=0; d<MAXDIMS; d++) p->n[d] = 256;
+  p->generator = mersenne;
+  p->seed = 23516;
+  p->gaussian = FALSE;
+  p->colored = FALSE;
+  p->exponent = 1.0;
+  p->longestWavelength = -1.0;
+  p->shortestWavelength = -1.0;
+}
+
+
+//
+// Make sure the work array holds at least nfloats
+//
+static int growWork (NGCONTEXT* ctx, const size_t nfloats) {
+  if (ctx->workSize >= nfloats) return(0);
+  if (ctx->work) fftwf_free(ctx->work);
+  ctx->work = (float*) fftwf_malloc(nfloats*sizeof(float));
+  ctx->workSize = ctx->work ? nfloats : 0;
+  if (!ctx->work) {
+    fprintf(stderr,"ERROR (growWork): could not allocate %zu floats\n",nfloats);
+    return(1);
+  }
+  return(0);
+}
+
+//
+// The filter for these sizes and this shape, remade only if either
+// changed; NULL if it could not be made
+//
+static const FILTER* getFilter (NGCONTEXT* ctx, const uint8_t numDims, const NGPARAMS* p) {
+
+  BOOL same = ctx->haveFilter && ctx->numDims == numDims &&
+              ctx->exponent == p->exponent &&
+              ctx->longestWavelength == p->longestWavelength &&
+              ctx->shortestWavelength == p->shortestWavelength &&
+              ctx->numPlanes == p->numPlanes;
+  for (uint8_t d=0; d<numDims && same; d++) same = (ctx->n[d] == p->n[d]);
+  if (same && p->numPlanes > 0) {
+    same = (memcmp(ctx->planes, p->planes, p->numPlanes*sizeof(PLANE)) == 0);
+  }
+  if (same) return &ctx->filter.filter;
+
+  if (ctx->haveFilter) freeNoiseFilter(&ctx->filter);
+  ctx->haveFilter = FALSE;
+  float ntotal = 1.0;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= (float)p->n[d];
+  if (makeNoiseFilter(&ctx->filter, numDims, p->n, 1.0/ntotal,
+                      p->longestWavelength, p->shortestWavelength, p->exponent,
+                      p->numPlanes, p->planes)) return NULL;
+
+  ctx->haveFilter = TRUE;
+  ctx->numDims = numDims;
+  for (uint8_t d=0; d<MAXDIMS; d++) ctx->n[d] = p->n[d];
+  ctx->exponent = p->exponent;
+  ctx->longestWavelength = p->longestWavelength;
+  ctx->shortestWavelength = p->shortestWavelength;
+  ctx->numPlanes = p->numPlanes;
+  if (p->numPlanes > 0) memcpy(ctx->planes, p->planes, p->numPlanes*sizeof(PLANE));
+
+  return &ctx->filter.filter;
+}
+
+
+//
+// The 2D and 3D pipeline, ending in out, which holds n[0]*...*n[last],
+// or if out is NULL, in the work array of the context; return where
+// the field is, or NULL on failure
+//
+static float* generate (NGCONTEXT* ctx, const uint8_t numDims, const NGPARAMS* p,
+    const NGHOOKS* hooks, float* out) {
+
+  if (!ctx || !p) {
+    fprintf(stderr,"ERROR (generate): needs a context and parameters\n");
+    return NULL;
+  }
+  if (p->numPlanes > MAXPLANES) {
+    fprintf(stderr,"ERROR (generate): at most %d planes\n",MAXPLANES);
+    return NULL;
+  }
+  size_t ntotal = 1;
+  float ntotalf = 1.0;
+  for (uint8_t d=0; d<numDims; d++) {
+    ntotal *= p->n[d];
+    ntotalf *= (float)p->n[d];
+  }
+  if (ntotal < 1) {
+    fprintf(stderr,"ERROR (generate): every size must be 1 or more\n");
+    return NULL;
+  }
+
+  const BOOL colored = p->colored || p->numPlanes > 0;
+  const BOOL hooked = hooks && (hooks->loadSpectrum || hooks->unshaped || hooks->shaped);
+  const float whiteStddev = p->gaussian ? 1.0 : 1.0/sqrt(3.0);
+  float* field = out;
+
+  if (!colored && !hooked) {
+    // white noise goes right where it is wanted
+    if (!out) {
+      if (growWork(ctx, ntotal)) return NULL;
+      field = ctx->work;
+    }
+    if (p->gaussian) getRandomGaussian(p->generator,p->seed,field,ntotal,0.0,1.0);
+    else getRandomUniform(p->generator,p->seed,field,ntotal,-1.0,1.0);
+
+  } else {
+    const size_t nlast = p->n[numDims-1];
+    const size_t nrows = ntotal / nlast;
+    if (growWork(ctx, nrows*2*(nlast/2+1))) return NULL;
+    float* work = ctx->work;
+    fftwf_complex* cwork = (fftwf_complex*)work;
+    const ptrdiff_t dims[MAXDIMS] = {(ptrdiff_t)p->n[0], (ptrdiff_t)p->n[1], (ptrdiff_t)p->n[2]};
+
+    // the scale still owed after the inverse transform
+    float factor = 1.0;
+
+    if (hooks && hooks->loadSpectrum) {
+      // shaped, 1/N included, straight out of the file
+      if (shapeSavedSpectrum(hooks->loadSpectrum, numDims, p->n, cwork, colored,
+                             p->longestWavelength, p->shortestWavelength, p->exponent,
+                             p->numPlanes, p->planes)) {
+        return NULL;
+      }
+
+    } else {
+      if (p->spectral && colored) {
+        if (numDims == 2) {
+          synthesize2D(work,p->generator,p->seed,p->n[0],p->n[1],whiteStddev);
+        } else {
+          synthesize3D(work,p->generator,p->seed,p->n[0],p->n[1],p->n[2],whiteStddev);
+        }
+      } else {
+        if (p->gaussian) getRandomGaussian(p->generator,p->seed,work,ntotal,0.0,1.0);
+        else getRandomUniform(p->generator,p->seed,work,ntotal,-1.0,1.0);
+        padRealArray(work, nrows, nlast);
+        if (executeR2C(numDims, dims, work, cwork)) return NULL;
+      }
+      if (hooks && hooks->unshaped && hooks->unshaped(hooks->user, cwork)) return NULL;
+
+      // shape it, 1/N included
+      if (colored) {
+        const FILTER* f = getFilter(ctx, numDims, p);
+        if (!f || applyFilter(cwork, f)) return NULL;
+      } else {
+        factor = 1.0/ntotalf;
+      }
+    }
+    if (hooks && hooks->shaped && hooks->shaped(hooks->user, cwork, factor)) return NULL;
+
+    if (out) {
+      // transform straight into out
+      if (executeC2R(numDims, dims, cwork, out)) return NULL;
+      if (factor != 1.0) {
+        #pragma omp parallel for schedule(static)
+        for (size_t i=0; i<ntotal; i++) out[i] *= factor;
+      }
+    } else {
+      // or in place, and close up the padding
+      if (executeC2R(numDims, dims, cwork, work)) return NULL;
+      if (factor != 1.0) scalePaddedArray(work, nrows, nlast, factor);
+      unpadRealArray(work, nrows, nlast, 1.0);
+      field = work;
+    }
+  }
+
+  if (p->zeroMean && numDims == 2) normalizeInPlace(field, ntotal);
+
+  return field;
+}
+
+
+/*
+ * Fill out with n[0] samples of 1D noise
+ */
+int ng_generate_1d (NGCONTEXT* ctx, const NGPARAMS* p, float* out) {
+  if (!ctx || !p || !out || p->n[0] < 1) {
+    fprintf(stderr,"ERROR (ng_generate_1d): needs a context, parameters, and an output array\n");
+    return(1);
+  }
+  if (p->gaussian) getRandomGaussian(p->generator,p->seed,out,p->n[0],0.0,1.0);
+  else getRandomUniform(p->generator,p->seed,out,p->n[0],-1.0,1.0);
+  if (p->colored) {
+    return shiftSpectrum1D(out,p->n[0],p->longestWavelength,p->shortestWavelength,p->exponent);
+  }
+  return(0);
+}
+
+/*
+ * Fill out with n[0] by n[1] noise, last index fastest
+ */
+int ng_generate_2d (NGCONTEXT* ctx, const NGPARAMS* p, float* out) {
+  if (!out) {
+    fprintf(stderr,"ERROR (ng_generate_2d): needs an output array\n");
+    return(1);
+  }
+  return generate(ctx, 2, p, NULL, out) ? 0 : 1;
+}
+
+/*
+ * Fill out with n[0] by n[1] by n[2] noise, last index fastest
+ */
+int ng_generate_3d (NGCONTEXT* ctx, const NGPARAMS* p, float* out) {
+  if (!out) {
+    fprintf(stderr,"ERROR (ng_generate_3d): needs an output array\n");
+    return(1);
+  }
+  return generate(ctx, 3, p, NULL, out) ? 0 : 1;
+}
+
+/*
+ * Make 2D or 3D noise in the context's own array, with hooks on the
+ * spectrum if hooks is not NULL, and return it; it stays valid until
+ * the next call with this context. One padded array is all it takes,
+ * so this is the lightest way to make one big field
+ */
+float* ng_generate_inplace (NGCONTEXT* ctx, const uint8_t numDims, const NGPARAMS* p,
+    const NGHOOKS* hooks) {
+  if (numDims < 2 || numDims > 3) {
+    fprintf(stderr,"ERROR (ng_generate_inplace): only for 2D and 3D\n");
+    return NULL;
+  }
+  return generate(ctx, numDims, p, hooks, NULL);
+}
+
+/*
+ * The file type that a file name's extension asks for, or fallback
+ */
+OUTFF ng_output_type (const char* outfile, const OUTFF fallback) {
+
+  // is there an extension?
+  const char* dotptr = outfile ? strrchr(outfile,'.') : NULL;
+  if (!dotptr) return fallback;
+
+  // does it match any of the predefined output types?
+  dotptr++;
+  if (strncmp(dotptr, "t", 1) == 0) return text;
+  if (strncmp(dotptr, "raw", 3) == 0) return raw;
+  if (strncmp(dotptr, "png", 3) == 0) return png;
+  if (strncmp(dotptr, "wav", 3) == 0) return wav;
+  if (strncmp(dotptr, "bob", 3) == 0) return bob;
+  if (strncmp(dotptr, "bos", 3) == 0) return bos;
+  return fallback;
+}
@@ -0,0 +1,85 @@
+/*
+ * libnoisegen.h - part of noisegen
+ *
+ * Library interface: make noise straight into caller memory, as often
+ * as needed, from one long-lived context
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+#include "output.h"
+#include "planes.h"
+#include "rng.hpp"
+#include "sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// what to make; the same choices as the command line
+typedef struct ngParamsType {
+  // sizes, of which the first 1, 2, or 3 are used
+  size_t n[MAXDIMS];
+  RNG generator;
+  int seed;
+  BOOL gaussian;
+  // white noise, or amplitude ~ f^exponent (-1 is pink), limited to
+  // wavelengths in [shortest,longest] where those are above 0
+  BOOL colored;
+  float exponent;
+  float longestWavelength;
+  float shortestWavelength;
+  // preference planes, 2D and 3D only
+  uint32_t numPlanes;
+  const PLANE* planes;
+  // make the 2D/3D spectrum directly instead of transforming white noise
+  BOOL spectral;
+  // remove the mean, 2D only, as with -zero
+  BOOL zeroMean;
+} NGPARAMS;
+
+// optional steps inside a 2D or 3D run, for callers that want the
+// spectrum itself: shape a saved spectrum file instead of making new
+// noise, look at the r2c spectrum before it is shaped, and look at it
+// after, with the scale that the inverse transform still owes it; a
+// hook that returns nonzero stops the run
+typedef struct ngHooksType {
+  const char* loadSpectrum;
+  int (*unshaped)(void*, const void*);
+  int (*shaped)(void*, const void*, const float);
+  void* user;
+} NGHOOKS;
+
+// buffers and the last filter, opaque to callers
+typedef struct ngContextType NGCONTEXT;
+
+NGCONTEXT* ng_create (void);
+void ng_destroy (NGCONTEXT*);
+void ng_default_params (NGPARAMS*);
+int ng_generate_1d (NGCONTEXT*, const NGPARAMS*, float*);
+int ng_generate_2d (NGCONTEXT*, const NGPARAMS*, float*);
+int ng_generate_3d (NGCONTEXT*, const NGPARAMS*, float*);
+float* ng_generate_inplace (NGCONTEXT*, const uint8_t, const NGPARAMS*, const NGHOOKS*);
+OUTFF ng_output_type (const char*, const OUTFF);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,305 @@
+/*
+ * mpinoise.c - part of noisegen
+ *
+ * Make 2D and 3D noise with FFTW-MPI. Every rank owns a slab of
+ * whole rows along the first axis, fills it from the counter-based
+ * generator at its global offset, filters its part of the spectrum
+ * with the global wavenumbers, and writes its own part of the file.
+ *
+ * link with -lfftw3f_mpi -lfftw3f and MPI
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef USE_MPI
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <float.h>
+#include <mpi.h>
+#include <fftw3-mpi.h>
+#include "fft.h"
+#include "filter.h"
+#include "output2d.h"
+#include "output3d.h"
+#include "mpinoise.h"
+
+
+//
+// Start MPI, must come before anything reads the command line
+//
+void startDistributed (int* argc, char*** argv, int* rank, int* nranks) {
+  MPI_Init(argc, argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, rank);
+  MPI_Comm_size(MPI_COMM_WORLD, nranks);
+}
+
+//
+// FFTW-MPI needs its threads set up first, see setFFTThreads
+//
+void startDistributedFFT () {
+  fftwf_mpi_init();
+}
+
+void endDistributed () {
+  fftwf_mpi_cleanup();
+  MPI_Finalize();
+}
+
+
+//
+// Write this rank's rows; raw, bob, and bos go straight to their
+// offsets in the file, anything else is gathered onto rank 0; every
+// rank returns 1 if any part of the file could not be written
+//
+static int writeDistributed (const OUTFF type, char* outfile,
+    const uint8_t numDims, const size_t* n,
+    const size_t first, const size_t count, float* data) {
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int rank, nranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nranks);
+
+  size_t perRow = 1;
+  for (uint8_t d=1; d<numDims; d++) perRow *= n[d];
+  const size_t nlocal = count*perRow;
+
+  const BOOL direct = outfile && (type == raw ||
+                      (numDims == 3 && (type == bob || type == bos)));
+
+  if (!direct) {
+    // MPI_Gatherv counts and offsets are ints
+    if (n[0]*perRow > (size_t)INT_MAX) {
+      if (rank == 0) fprintf(stderr,"ERROR (writeDistributed): more than %d points can "
+                                    "only be written to a raw, bob, or bos file\n",INT_MAX);
+      return(1);
+    }
+
+    // everyone sends their rows to rank 0, if it has room for them
+    int* counts = NULL;
+    int* offsets = NULL;
+    float* all = NULL;
+    int failed = 0;
+    if (rank == 0) {
+      counts = (int*) malloc(nranks*sizeof(int));
+      offsets = (int*) malloc(nranks*sizeof(int));
+      all = (float*) malloc(n[0]*perRow*sizeof(float));
+      if (!counts || !offsets || !all) {
+        fprintf(stderr,"ERROR (writeDistributed): could not allocate the gathered grid\n");
+        failed = 1;
+      }
+    }
+    MPI_Bcast(&failed, 1, MPI_INT, 0, comm);
+
+    if (!failed) {
+      const int mine = (int)nlocal;
+      MPI_Gather(&mine, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+      if (rank == 0) {
+        offsets[0] = 0;
+        for (int r=1; r<nranks; r++) offsets[r] = offsets[r-1] + counts[r-1];
+      }
+      MPI_Gatherv(data, mine, MPI_FLOAT, all, counts, offsets, MPI_FLOAT, 0, comm);
+      if (rank == 0) {
+        if (numDims == 2) failed = writeData2D(type, outfile, all, n[0], n[1]);
+        else failed = writeData3D(type, outfile, all, n[0], n[1], n[2]);
+      }
+      MPI_Bcast(&failed, 1, MPI_INT, 0, comm);
+    }
+    free(all);
+    free(counts);
+    free(offsets);
+    return(failed);
+  }
+
+  // bricks scale by the range of the whole volume
+  float datmin = FLT_MAX;
+  float datmax = -FLT_MAX;
+  if (type == bob || type == bos) {
+    for (size_t i=0; i<nlocal; i++) {
+      if (data[i] < datmin) datmin = data[i];
+      if (data[i] > datmax) datmax = data[i];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &datmin, 1, MPI_FLOAT, MPI_MIN, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &datmax, 1, MPI_FLOAT, MPI_MAX, comm);
+  }
+
+  MPI_File fh;
+  if (MPI_File_open(comm, outfile, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                    MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+    if (rank == 0) fprintf(stderr,"ERROR (writeDistributed): could not open %s\n",outfile);
+    return(1);
+  }
+  int failed = (MPI_File_set_size(fh, 0) != MPI_SUCCESS);
+
+  // the brick formats start with three 4-byte sizes
+  const MPI_Offset header = (type == raw) ? 0 : 3*sizeof(uint32_t);
+  if (rank == 0 && header > 0) {
+    uint32_t outputRes[3] = {(uint32_t)n[0], (uint32_t)n[1], (uint32_t)n[2]};
+    if (MPI_File_write_at(fh, 0, outputRes, 3, MPI_UINT32_T, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+      failed = 1;
+    }
+  }
+
+  // MPI counts are ints, so large slabs go out in pieces
+  const size_t chunk = (size_t)1 << 28;
+  if (type == raw) {
+    for (size_t i=0; i<nlocal && !failed; i+=chunk) {
+      const int cnt = (int)((nlocal-i < chunk) ? nlocal-i : chunk);
+      const MPI_Offset off = (MPI_Offset)((first*perRow + i)*sizeof(float));
+      if (MPI_File_write_at(fh, off, data+i, cnt, MPI_FLOAT, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+        failed = 1;
+      }
+    }
+
+  } else if (type == bob) {
+    char* brick = (char*) malloc(sizeof(char)*nlocal);
+    if (!brick) failed = 1;
+    for (size_t i=0; i<nlocal && !failed; i++)
+      brick[i] = (char)(255.999 * (data[i]-datmin) / (datmax-datmin));
+    for (size_t i=0; i<nlocal && !failed; i+=chunk) {
+      const int cnt = (int)((nlocal-i < chunk) ? nlocal-i : chunk);
+      const MPI_Offset off = header + (MPI_Offset)(first*perRow + i);
+      if (MPI_File_write_at(fh, off, brick+i, cnt, MPI_CHAR, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+        failed = 1;
+      }
+    }
+    free(brick);
+
+  } else if (type == bos) {
+    uint16_t* brick = (uint16_t*) malloc(sizeof(uint16_t)*nlocal);
+    if (!brick) failed = 1;
+    for (size_t i=0; i<nlocal && !failed; i++)
+      brick[i] = (uint16_t)(65535.9 * (data[i]-datmin) / (datmax-datmin));
+    for (size_t i=0; i<nlocal && !failed; i+=chunk) {
+      const int cnt = (int)((nlocal-i < chunk) ? nlocal-i : chunk);
+      const MPI_Offset off = header + (MPI_Offset)((first*perRow + i)*sizeof(uint16_t));
+      if (MPI_File_write_at(fh, off, brick+i, cnt, MPI_UINT16_T, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+        failed = 1;
+      }
+    }
+    free(brick);
+  }
+
+  if (MPI_File_close(&fh) != MPI_SUCCESS) failed = 1;
+
+  // any rank's failure is everyone's
+  MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, comm);
+  if (failed && rank == 0) fprintf(stderr,"ERROR (writeDistributed): could not write %s\n",outfile);
+  return(failed);
+}
+
+
+/*
+ * Generate, color, and write 2D or 3D noise across all ranks; the
+ * generator must be able to start at any offset (philox)
+ */
+int makeNoiseDistributed (const uint8_t numDims, const size_t* n,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const OUTFF outtype, char* outfile) {
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  const size_t nlast = n[numDims-1];
+  const size_t nlastc = nlast/2+1;
+
+  // which rows along the first axis are ours?
+  ptrdiff_t localN0, local0Start, allocLocal;
+  if (numDims == 2) {
+    allocLocal = fftwf_mpi_local_size_2d(n[0], nlastc, comm, &localN0, &local0Start);
+  } else {
+    allocLocal = fftwf_mpi_local_size_3d(n[0], n[1], nlastc, comm, &localN0, &local0Start);
+  }
+  const size_t rowsPerSlab = (numDims == 3) ? n[1] : 1;
+  const size_t nrows = (size_t)localN0 * rowsPerSlab;
+  const size_t nlocal = nrows * nlast;
+
+  // room for the padded in-place spectrum, never less than one complex
+  float* data = fftwf_alloc_real(2*(allocLocal > 0 ? allocLocal : 1));
+
+  // plan before filling, since measuring overwrites the arrays
+  fftwf_plan forward = NULL;
+  fftwf_plan backward = NULL;
+  if (colored) {
+    const unsigned flags = getPlannerEffort();
+    fftwf_complex* cdata = (fftwf_complex*)data;
+    if (numDims == 2) {
+      forward = fftwf_mpi_plan_dft_r2c_2d(n[0], n[1], data, cdata, comm, flags);
+      backward = fftwf_mpi_plan_dft_c2r_2d(n[0], n[1], cdata, data, comm, flags);
+    } else {
+      forward = fftwf_mpi_plan_dft_r2c_3d(n[0], n[1], n[2], data, cdata, comm, flags);
+      backward = fftwf_mpi_plan_dft_c2r_3d(n[0], n[1], n[2], cdata, data, comm, flags);
+    }
+    if (!forward || !backward) {
+      fprintf(stderr,"ERROR (makeNoiseDistributed): FFTW could not make a plan\n");
+      return(1);
+    }
+  }
+
+  // the same samples the serial run puts in these rows
+  const size_t offset = (size_t)local0Start * rowsPerSlab * nlast;
+  if (gaussian) {
+    getRandomGaussianAt(generator,randSeed,offset,data,nlocal,0.0,1.0);
+  } else {
+    getRandomUniformAt(generator,randSeed,offset,data,nlocal,-1.0,1.0);
+  }
+
+  int failed = 0;
+  if (colored) {
+    padRealArray(data, nrows, nlast);
+    fftwf_mpi_execute_dft_r2c(forward, data, (fftwf_complex*)data);
+
+    // the same filter as in core, on our rows only
+    float ntotal = 1.0;
+    for (uint8_t d=0; d<numDims; d++) ntotal *= (float)n[d];
+    NOISEFILTER nf;
+    if (makeNoiseFilter(&nf, numDims, n, 1.0/ntotal,
+                        longestWavelength, shortestWavelength, exponent, numPlanes, pp)) {
+      failed = 1;
+    } else {
+      const size_t lo[2] = {(size_t)local0Start, 0};
+      const size_t cnt[2] = {(size_t)localN0, n[1]};
+      failed = applyFilterBlock(data, &nf.filter, lo, cnt);
+      freeNoiseFilter(&nf);
+    }
+
+    fftwf_mpi_execute_dft_c2r(backward, (fftwf_complex*)data, data);
+    unpadRealArray(data, nrows, nlast, 1.0);
+
+    fftwf_destroy_plan(forward);
+    fftwf_destroy_plan(backward);
+  }
+
+  // the transforms are collective, so every rank gets this far first
+  MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, comm);
+  if (failed) {
+    fftwf_free(data);
+    return(1);
+  }
+
+  const int retval = writeDistributed(outtype, outfile, numDims, n,
+                                      (size_t)local0Start, (size_t)localN0, data);
+  fftwf_free(data);
+
+  return(retval);
+}
+
+#endif
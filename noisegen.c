@@ -44,24 +44,82 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "noisegen.h"
 #include "fft.h"
+#include "fftplan.h"
 #include "rng.hpp"
 #include "output.h"
 #include "output1d.h"
 #include "output2d.h"
 #include "output3d.h"
 #include "planes.h"
+#include "ooc3d.h"
+#include "ensemble.h"
+#include "animate.h"
+#include "pyramid.h"
+#include "tile2d.h"
+#include "sample.h"
+#include "libnoisegen.h"
+#include "server.h"
+#include "jobs.h"
+#include "stream1d.h"
+#include "iir1d.h"
+#include "spectrum.h"
+#include "mpinoise.h"
 
-void blur2D(float*, size_t, size_t);
+
+//
+// What a still 2D or 3D run does with its spectrum on the way through
+//
+typedef struct stillSpectrumType {
+  uint8_t numDims;
+  const size_t* n;
+  // where to save it unshaped, and what made it
+  const char* spectrumOut;
+  int seed;
+  BOOL gaussian;
+  RNG generator;
+  BOOL synthesized;
+  // the mipmaps cut from it once shaped
+  size_t numLevels;
+  BOOL zeroMean;
+  OUTFF outtype;
+  char* outfile;
+  // set if any of them could not be made or written
+  BOOL levelsFailed;
+} STILLSPECTRUM;
+
+static int saveUnshaped (void* user, const void* spectrum) {
+  const STILLSPECTRUM* s = (const STILLSPECTRUM*)user;
+  return saveSpectrum(s->spectrumOut, s->numDims, s->n, s->seed, s->gaussian,
+                      s->generator, s->synthesized, spectrum);
+}
+
+//
+// A level that fails is remembered rather than stopping the run, so
+// that the full-size grid is still written
+//
+static int writeLevels (void* user, const void* spectrum, const float factor) {
+  STILLSPECTRUM* s = (STILLSPECTRUM*)user;
+  if (writePyramid(s->numDims, s->n, spectrum, factor, s->numLevels, s->zeroMean,
+                   s->outtype, s->outfile)) {
+    s->levelsFailed = TRUE;
+  }
+  return(0);
+}
 int Usage(char[255], int);
 
 typedef enum noiseColorType {white,pink,red,brown,blue,violet} COLOR;
 typedef enum noisePdfType {uniform,Gaussian} PDF;
+typedef enum noiseEngineType {wholefft,stream,iir} ENGINE;
 
 
 int main (int argc, char **argv) {
@@ -72,7 +130,7 @@ int main (int argc, char **argv) {
   // how many dimensions of noise do we want?
   uint8_t numDims = 1;
   // data array size for each dimension
-  uint32_t n[MAXDIMS] = {100,1,1};
+  size_t n[MAXDIMS] = {100,1,1};
   // arrays for the data itself
   float* data;
   // DC voltage (mean signal)
@@ -91,20 +149,66 @@ int main (int argc, char **argv) {
   PLANE planes[MAXPLANES];
   // zero mean?
   BOOL zeroMean = FALSE;
+  // make the 2D/3D spectrum directly instead of transforming white noise?
+  BOOL spectralSynthesis = FALSE;
   // noise probabilty distribution function
   PDF noisePdf = uniform;
   // random number generator
   RNG generator = mersenne;
   // seed for rng
   int randSeedVal = 23516;
+  // number of realizations, each with the next seed
+  size_t count = 1;
+  // 2D/3D only: number of frames of evolving noise, and how fast
+  size_t frames = 1;
+  float frameRate = ANIMATERATE;
+  // 2D/3D only: number of mipmap levels, each half the size
+  size_t numLevels = 1;
+  // 2D only: make just the tile of an endless field that starts here
+  BOOL tiled = FALSE;
+  int64_t tileOrigin[2] = {0, 0};
+  // 2D/3D only: points to look up in the finished grid, and how
+  char* queryFile = NULL;
+  // answer requests on this socket instead of making one field
+  char* serveSocket = NULL;
+  // or run every job in this manifest
+  char* jobFile = NULL;
+  INTERP interpolation = linear;
+  // 1D only: filter the whole signal at once, or block by block
+  ENGINE engine = wholefft;
+  size_t blockSize = STREAMBLOCK;
+  // FIR kernel size, 0 for the default of whatever uses it
+  size_t numTaps = 0;
+  size_t numChannels = 1;
+  // number of threads to use, 1 means serial
+#ifdef _OPENMP
+  int numThreads = omp_get_num_procs();
+#else
+  int numThreads = 1;
+#endif
   // output file types
   OUTFF outtype = text;
   char* outfile = NULL;
+  // FFTW planner rigor and file to keep measured plans in
+  unsigned plannerEffort = FFTW_ESTIMATE;
+  char* wisdomFile = NULL;
+  // scratch file for volumes that do not fit in memory
+  char* scratchFile = NULL;
+  // files to keep the unshaped spectrum in, or to start from
+  char* spectrumOut = NULL;
+  char* spectrumIn = NULL;
+  // this process's place among the MPI ranks, if any
+  int mpiRank = 0;
+  int mpiSize = 1;
   
 
   //-------------------------------------------------------------------------
   // read command line
 
+#ifdef USE_MPI
+  startDistributed(&argc,&argv,&mpiRank,&mpiSize);
+#endif
+
   char progname[255];
   (void) strcpy(progname,argv[0]);
   if (argc < 2) (void) Usage(progname,0);
@@ -114,18 +218,21 @@ int main (int argc, char **argv) {
       numDims = atoi(argv[++i]);
 
     } else if (strncmp(argv[i], "-n", 2) == 0) {
-      n[0] = (size_t)atol(argv[++i]);
+      n[0] = (size_t)strtoull(argv[++i],NULL,10);
       if (argc > i+1) {
         if (isdigit((int)argv[i+1][0])) {
-          n[1] = (size_t)atol(argv[++i]);
+          n[1] = (size_t)strtoull(argv[++i],NULL,10);
           if (argc > i+1) {
             if (isdigit(argv[i+1][0])) {
-              n[2] = (size_t)atol(argv[++i]);
+              n[2] = (size_t)strtoull(argv[++i],NULL,10);
             }
           }
         }
       }
 
+    } else if (strncmp(argv[i], "-ooc", 4) == 0) {
+      scratchFile = (char*) malloc(255*sizeof(char));
+      strcpy(scratchFile,argv[++i]);
     } else if (strncmp(argv[i], "-o", 2) == 0) {
       outfile = (char*) malloc(255*sizeof(char));
       strcpy(outfile,argv[++i]);
@@ -133,8 +240,63 @@ int main (int argc, char **argv) {
       generator = library;
     } else if (strncmp(argv[i], "-zero", 2) == 0) {
       zeroMean = TRUE;
+    } else if (strncmp(argv[i], "-philox", 3) == 0) {
+      generator = philox;
+    } else if (strncmp(argv[i], "-serve", 4) == 0) {
+      serveSocket = (char*) malloc(255*sizeof(char));
+      strcpy(serveSocket,argv[++i]);
     } else if (strncmp(argv[i], "-seed", 5) == 0) {
       randSeedVal = (int)atoi(argv[++i]);
+    } else if (strncmp(argv[i], "-jobs", 3) == 0) {
+      jobFile = (char*) malloc(255*sizeof(char));
+      strcpy(jobFile,argv[++i]);
+    } else if (strncmp(argv[i], "-engine", 3) == 0) {
+      i++;
+      if (strncmp(argv[i], "f", 1) == 0) {
+        engine = wholefft;
+      } else if (strncmp(argv[i], "s", 1) == 0) {
+        engine = stream;
+      } else if (strncmp(argv[i], "i", 1) == 0) {
+        engine = iir;
+      } else {
+        fprintf(stderr,"Unknown engine (%s)\n",argv[i]);
+        (void) Usage(progname,0);
+      }
+    } else if (strncmp(argv[i], "-block", 4) == 0) {
+      blockSize = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-query", 2) == 0) {
+      queryFile = (char*) malloc(255*sizeof(char));
+      strcpy(queryFile,argv[++i]);
+    } else if (strncmp(argv[i], "-cubic", 3) == 0) {
+      interpolation = cubic;
+    } else if (strncmp(argv[i], "-tile", 3) == 0) {
+      tiled = TRUE;
+      tileOrigin[0] = (int64_t)strtoll(argv[++i],NULL,10);
+      tileOrigin[1] = (int64_t)strtoll(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-taps", 3) == 0) {
+      numTaps = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-channels", 3) == 0) {
+      numChannels = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-count", 3) == 0) {
+      count = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-frames", 3) == 0) {
+      frames = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-rate", 3) == 0) {
+      frameRate = (float)atof(argv[++i]);
+    } else if (strncmp(argv[i], "-levels", 3) == 0) {
+      numLevels = (size_t)strtoull(argv[++i],NULL,10);
+    } else if (strncmp(argv[i], "-threads", 2) == 0) {
+      numThreads = atoi(argv[++i]);
+
+    } else if (strncmp(argv[i], "-spectral", 3) == 0) {
+      spectralSynthesis = TRUE;
+
+    } else if (strncmp(argv[i], "-save", 3) == 0) {
+      spectrumOut = (char*) malloc(255*sizeof(char));
+      strcpy(spectrumOut,argv[++i]);
+    } else if (strncmp(argv[i], "-load", 4) == 0) {
+      spectrumIn = (char*) malloc(255*sizeof(char));
+      strcpy(spectrumIn,argv[++i]);
 
     } else if (strncmp(argv[i], "-short", 3) == 0) {
       shortestWavelength = (float)atof(argv[++i]);
@@ -142,6 +304,24 @@ int main (int argc, char **argv) {
       longestWavelength = (float)atof(argv[++i]);
 
 
+    } else if (strncmp(argv[i], "-plan", 3) == 0) {
+      i++;
+      if (strncmp(argv[i], "es", 2) == 0) {
+        plannerEffort = FFTW_ESTIMATE;
+      } else if (strncmp(argv[i], "m", 1) == 0) {
+        plannerEffort = FFTW_MEASURE;
+      } else if (strncmp(argv[i], "p", 1) == 0) {
+        plannerEffort = FFTW_PATIENT;
+      } else if (strncmp(argv[i], "ex", 2) == 0) {
+        plannerEffort = FFTW_EXHAUSTIVE;
+      } else {
+        fprintf(stderr,"Unknown planner effort (%s)\n",argv[i]);
+        (void) Usage(progname,0);
+      }
+    } else if (strncmp(argv[i], "-wisdom", 3) == 0) {
+      wisdomFile = (char*) malloc(255*sizeof(char));
+      strcpy(wisdomFile,argv[++i]);
+
     } else if (strncmp(argv[i], "-red", 4) == 0) {
       noiseColor = red;
     } else if (strncmp(argv[i], "-brown", 5) == 0) {
@@ -178,6 +358,14 @@ int main (int argc, char **argv) {
     }
   }
 
+  // a saved spectrum sets the sizes
+  if (spectrumIn) {
+    SPECHEADER header;
+    if (readSpectrumHeader(spectrumIn,&header)) exit(1);
+    numDims = (uint8_t)header.numDims;
+    for (uint8_t i=0; i<MAXDIMS; i++) n[i] = (size_t)header.n[i];
+  }
+
   //-------------------------------------------------------------------------
   // vet inputs
   if (numDims < 1 || numDims > SUPPORTEDDIMS) {
@@ -185,44 +373,152 @@ int main (int argc, char **argv) {
     exit(1);
   }
 
+  // a stream is never all in memory and has no header, and a length
+  // of 0 keeps it going until it is stopped
+  const BOOL streaming = (engine == stream || engine == iir);
+  if (streaming && (numDims != 1 || count > 1)) {
+    fprintf(stderr,"ERROR: -engine stream and iir only make one 1D signal\n");
+    exit(1);
+  }
+  if (numChannels < 1 || (numChannels > 1 && engine != iir)) {
+    fprintf(stderr,"ERROR: -channels must be 1, or more with -engine iir\n");
+    exit(1);
+  }
+  if (engine == iir && (longestWavelength > 0.0 || shortestWavelength > 0.0)) {
+    fprintf(stderr,"WARNING: -long and -short are ignored by -engine iir\n");
+  }
+  if (numTaps == 0) numTaps = tiled ? TILETAPS : STREAMTAPS;
+  if (streaming && (blockSize < 1 || numTaps < 2)) {
+    fprintf(stderr,"ERROR: -block must be 1 or more and -taps 2 or more\n");
+    exit(1);
+  }
+
+  // file headers hold each size in 32 bits
   for (uint8_t i=0; i<MAXDIMS; i++) {
-    if (n[i] > UINT32_MAX/2) {
-      fprintf(stderr,"ERROR: You're asking for over 2.1 billion points...(%d)\n",n[i]);
+    if (streaming && i == 0) continue;
+    if (n[i] < 1 || n[i] > UINT32_MAX) {
+      fprintf(stderr,"ERROR: each size must be 1..%u (%zu)\n",UINT32_MAX,n[i]);
       exit(1);
     }
   }
-  float totalN = 1.0;
-  for (uint8_t i=0; i<MAXDIMS; i++) totalN *= (float)n[i];
-  if (totalN > (float)(UINT32_MAX/2)) {
-    fprintf(stderr,"ERROR: You're asking for over 2.1 billion total points...(%g)\n",totalN);
+  if (mpiSize > 1 && (numDims < 2 || scratchFile)) {
+    fprintf(stderr,"ERROR: runs on more than one rank need 2D or 3D and no -ooc\n");
+    exit(1);
+  }
+  if (count < 1) {
+    fprintf(stderr,"ERROR: -count must be 1 or more\n");
+    exit(1);
+  }
+  if (count > 1 && (!outfile || scratchFile || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: -count above 1 needs -o, and no -ooc or MPI\n");
+    exit(1);
+  }
+  if (frames < 1) {
+    fprintf(stderr,"ERROR: -frames must be 1 or more\n");
+    exit(1);
+  }
+  if (frames > 1 && (!outfile || numDims < 2 || count > 1 || spectrumOut ||
+                     scratchFile || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: -frames above 1 needs 2D or 3D and -o, and no -count,\n");
+    fprintf(stderr,"       -save-spectrum, -ooc, or MPI\n");
+    exit(1);
+  }
+  if (numLevels < 1) {
+    fprintf(stderr,"ERROR: -levels must be 1 or more\n");
     exit(1);
   }
+  if (numLevels > 1 && (!outfile || numDims < 2 || count > 1 || frames > 1 ||
+                        scratchFile || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: -levels above 1 needs 2D or 3D and -o, and no -count,\n");
+    fprintf(stderr,"       -frames, -ooc, or MPI\n");
+    exit(1);
+  }
+  for (uint8_t i=0; i<numDims && numLevels > 1; i++) {
+    if ((n[i] >> (numLevels-1)) < 1) {
+      fprintf(stderr,"ERROR: too many levels for size %zu\n",n[i]);
+      exit(1);
+    }
+  }
+  if (tiled && (numDims != 2 || numTaps < 2 || count > 1 || frames > 1 ||
+                numLevels > 1 || spectrumIn || spectrumOut || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: -tile only makes one 2D tile, with -taps 2 or more and\n");
+    fprintf(stderr,"       no -count, -frames, -levels, spectrum files, or MPI\n");
+    exit(1);
+  }
+  if (queryFile && (numDims < 2 || tiled || count > 1 || frames > 1 ||
+                    scratchFile || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: -query needs one in-memory 2D or 3D grid\n");
+    exit(1);
+  }
+  if (tiled && zeroMean) {
+    fprintf(stderr,"WARNING: -zero is ignored with -tile, it would leave seams\n");
+  }
+  if ((spectrumIn || spectrumOut) &&
+      (numDims < 2 || count > 1 || scratchFile || mpiSize > 1)) {
+    fprintf(stderr,"ERROR: spectrum files are only for single in-memory 2D and 3D runs\n");
+    exit(1);
+  }
+  if (scratchFile && numDims != 3) {
+    fprintf(stderr,"ERROR: -ooc only works for 3D noise\n");
+    exit(1);
+  }
+  // all sizes and indices are 64-bit, so the only limit is that the
+  // padded in-place array be addressable
+  size_t totalN = 1;
+  size_t paddedN = 1;
+  for (uint8_t i=0; i<numDims; i++) {
+    const size_t padded = (i == numDims-1) ? 2*(n[i]/2+1) : n[i];
+    if (!streaming && paddedN > (size_t)PTRDIFF_MAX / sizeof(float) / padded) {
+      fprintf(stderr,"ERROR: You're asking for too many total points\n");
+      exit(1);
+    }
+    totalN *= n[i];
+    paddedN *= padded;
+  }
 
-  // parse the input file name for file type
-  // was a file name given?
-  if (outfile) {
-    // is there an extension?
-    char* dotptr = strrchr(outfile,'.');
-    if (dotptr) {
-      // advance the pointer to the next character
-      dotptr++;
-      // does the extension match any of the predefined output types?
-      if (strncmp(dotptr, "t", 1) == 0) {
-        outtype = text;
-      } else if (strncmp(dotptr, "raw", 3) == 0) {
-        outtype = raw;
-      } else if (strncmp(dotptr, "png", 3) == 0) {
-        outtype = png;
-      } else if (strncmp(dotptr, "wav", 3) == 0) {
-        outtype = wav;
-      } else if (strncmp(dotptr, "bob", 3) == 0) {
-        outtype = bob;
-      } else if (strncmp(dotptr, "bos", 3) == 0) {
-        outtype = bos;
-      }
+  if (numThreads < 1) {
+    fprintf(stderr,"ERROR: number of threads must be 1 or more\n");
+    exit(1);
+  }
+#ifdef _OPENMP
+  omp_set_num_threads(numThreads);
+#endif
+
+  // prepare the FFT planner
+  setFFTThreads(numThreads);
+#ifdef USE_MPI
+  startDistributedFFT();
+#endif
+  setPlannerEffort(plannerEffort);
+  (void) loadWisdom(wisdomFile);
+
+  // as a server, the requests say what to make; the workers run side
+  // by side, so each transform gets one thread
+  if (serveSocket) {
+    if (mpiSize > 1) {
+      fprintf(stderr,"ERROR: -serve runs on one rank only\n");
+      exit(1);
+    }
+    setFFTThreads(1);
+    const int retval = serveNoise(serveSocket,numThreads);
+    (void) saveWisdom(wisdomFile);
+    exit(retval);
+  }
+
+  // likewise for a batch, whose jobs pick their own threads
+  if (jobFile) {
+    if (mpiSize > 1) {
+      fprintf(stderr,"ERROR: -jobs runs on one rank only\n");
+      exit(1);
     }
+    const int retval = runJobs(jobFile,numThreads);
+    (void) saveWisdom(wisdomFile);
+    exit(retval);
   }
 
+  // parse the input file name for file type
+  outtype = ng_output_type(outfile, outtype);
+
 
   // convert the color to a power-law exponent
   if (noiseColor == red || noiseColor == brown) {
@@ -248,142 +544,222 @@ int main (int argc, char **argv) {
   }
 
 
-  //-------------------------------------------------------------------------
-  // split on number of dimensions
-  if (numDims == 1) {
-
-    // make space for the data
-    data = (float*) malloc(n[0]*sizeof(float));
+  // do we need to work in frequency space at all?
+  const BOOL colored = (noiseColor != white || useInputExponent || numPlanes > 0);
+  // and if so, can we start there?
+  const BOOL synthesize = (spectralSynthesis && colored && numDims > 1);
 
-    // generate white (uncorrelated) noise
-    // split on sample distribution
-    if (noisePdf == uniform) {
-      getRandomUniform(generator,randSeedVal,data,n[0],-1.0,1.0);
-    } else if (noisePdf == Gaussian) {
-      getRandomGaussian(generator,randSeedVal,data,n[0],0.0,1.0);
+  // multithreaded 2D and 3D runs need a generator that can be split
+  // up without changing the answer
+  const RNG askedGenerator = generator;
+  if (numThreads > 1 && generator == mersenne && numDims > 1) {
+    generator = philox;
+  }
+  // and out-of-core, multi-rank, and streaming runs make their noise
+  // one piece at a time
+  if (scratchFile || mpiSize > 1 || streaming || tiled) {
+    generator = philox;
+  }
+  // the same seed gives different noise, so say so
+  if (generator != askedGenerator && mpiRank == 0) {
+    if (scratchFile || mpiSize > 1 || streaming || tiled) {
+      fprintf(stderr,"Using -philox, as this run makes its noise in pieces\n");
+    } else {
+      fprintf(stderr,"Using -philox, as -threads is above 1; use -threads 1 for mt19937 noise\n");
     }
+  }
+  if (zeroMean && mpiSize > 1 && mpiRank == 0) {
+    fprintf(stderr,"WARNING: -zero is ignored when running on more than one rank\n");
+  }
 
-    // shift power spectrum
-    if (noiseColor != white || useInputExponent)
-      shiftSpectrum1D(data,n[0],longestWavelength,shortestWavelength,powerExp);
-
-    // write resulting data
-    (void) writeData1D (outtype, outfile, data, n[0]);
-    //(void) writeSpectrum1D (outtype, outfile, data, n[0]);
+  // a single still field comes from the library, as any caller's would
+  NGPARAMS still;
+  ng_default_params(&still);
+  for (int i=0; i<3; i++) still.n[i] = n[i];
+  still.generator = generator;
+  still.seed = randSeedVal;
+  still.gaussian = (noisePdf == Gaussian);
+  still.colored = (noiseColor != white || useInputExponent);
+  still.exponent = powerExp;
+  still.longestWavelength = longestWavelength;
+  still.shortestWavelength = shortestWavelength;
+  still.numPlanes = numPlanes;
+  still.planes = planes;
+  still.spectral = spectralSynthesis;
+  still.zeroMean = zeroMean;
+  NGCONTEXT* ctx = NULL;
 
 
   //-------------------------------------------------------------------------
-  } else if (numDims == 2) {
+  // split on number of dimensions
+  if (count > 1) {
+
+    // all realizations share the plans, the filter, and the buffers
+    const size_t nn[3] = {n[0], n[1], n[2]};
+    const BOOL shift = (numDims == 1) ? (noiseColor != white || useInputExponent) : colored;
+    if (makeEnsemble(numDims,nn,count,generator,randSeedVal,
+                     noisePdf == Gaussian,shift,synthesize,
+                     longestWavelength,shortestWavelength,powerExp,
+                     numPlanes,planes,zeroMean,outtype,outfile)) {
+      exit(1);
+    }
 
-    data = (float*) malloc(n[0]*n[1]*sizeof(float*));
 
-    // generate white (uncorrelated) noise
-    // split on sample distribution
-    if (noisePdf == uniform) {
-      getRandomUniform(generator,randSeedVal,data,n[0]*n[1],-1.0,1.0);
-    } else if (noisePdf == Gaussian) {
-      getRandomGaussian(generator,randSeedVal,data,n[0]*n[1],0.0,1.0);
+  //-------------------------------------------------------------------------
+  } else if (frames > 1) {
+
+    // one shaped spectrum, advanced in phase and transformed per frame
+    const size_t nn[3] = {n[0], n[1], n[2]};
+    if (makeAnimation(numDims,nn,frames,frameRate,generator,randSeedVal,
+                      noisePdf == Gaussian,colored,synthesize,spectrumIn,
+                      longestWavelength,shortestWavelength,powerExp,
+                      numPlanes,planes,zeroMean,outtype,outfile)) {
+      exit(1);
     }
 
-    // play around a little
-    if (FALSE) {
-      writeData2D (outtype, "tempout0.png", data, n[0], n[1]);
-      blur2D(data,n[0],n[1]);
-    }
 
-    // shift power spectrum
-    if (noiseColor != white || useInputExponent || numPlanes > 0) {
+  //-------------------------------------------------------------------------
+  } else if (engine == iir) {
 
-      // generate the complex frequency spectrum
-      void* interim = decompose2D(data,n[0],n[1]);
+    // recursive filters, sample by sample, all channels at once
+    if (makeNoiseIIR1D(n[0],blockSize,numChannels,numTaps,generator,randSeedVal,
+                       noisePdf == Gaussian,noiseColor != white || useInputExponent,
+                       powerExp,outtype,outfile)) {
+      exit(1);
+    }
 
-      // shift it to color the noise
-      shiftPowerSpectrum2D(interim,n[0],n[1],longestWavelength,shortestWavelength,powerExp);
 
-      // add spikes emanating from the origin in f space
-      addPlanesToSpectrum2D(interim,n[0],n[1],numPlanes,planes);
+  //-------------------------------------------------------------------------
+  } else if (streaming) {
 
-      // reconstitute the signal
-      reproject2D(interim,n[0],n[1],data);
+    // filter and write one block at a time, for as long as asked
+    if (makeNoiseStream1D(n[0],blockSize,numTaps,generator,randSeedVal,
+                          noisePdf == Gaussian,noiseColor != white || useInputExponent,
+                          longestWavelength,shortestWavelength,powerExp,
+                          outtype,outfile)) {
+      exit(1);
     }
 
-    // renormalize
-    if (zeroMean)
-      normalizeInPlace(data,n[0]*n[1]);
+
+  //-------------------------------------------------------------------------
+  } else if (numDims == 1) {
+
+    // make space for the data, and the noise to fill it
+    data = (float*) malloc(n[0]*sizeof(float));
+    ctx = ng_create();
+    if (!data || !ctx || ng_generate_1d(ctx, &still, data)) exit(1);
 
     // write resulting data
-    writeData2D (outtype, outfile, data, n[0], n[1]);
+    if (writeData1D(outtype, outfile, data, n[0])) exit(1);
+    free(data);
 
 
   //-------------------------------------------------------------------------
-  } else if (numDims == 3) {
+#ifdef USE_MPI
+  } else if (mpiSize > 1) {
+
+    // every rank makes and writes its own slab
+    const size_t nn[3] = {n[0], n[1], n[2]};
+    if (makeNoiseDistributed(numDims,nn,generator,randSeedVal,
+                             noisePdf == Gaussian,colored,
+                             longestWavelength,shortestWavelength,powerExp,
+                             numPlanes,planes,outtype,outfile)) {
+      MPI_Abort(MPI_COMM_WORLD,1);
+    }
+#endif
 
-    data = (float*) malloc(n[0]*n[1]*n[2]*sizeof(float*));
 
-    // generate white (uncorrelated) noise
-    // split on sample distribution
-    if (noisePdf == uniform) {
-      getRandomUniform(generator,randSeedVal,data,n[0]*n[1]*n[2],-1.0,1.0);
-    } else if (noisePdf == Gaussian) {
-      getRandomGaussian(generator,randSeedVal,data,n[0]*n[1]*n[2],0.0,1.0);
+  //-------------------------------------------------------------------------
+  } else if (tiled) {
+
+    // one tile of the endless field, filtered through a windowed kernel
+    const size_t nn[2] = {n[0], n[1]};
+    if (makeNoiseTile2D(tileOrigin,nn,numTaps,generator,randSeedVal,
+                        noisePdf == Gaussian,colored,
+                        longestWavelength,shortestWavelength,powerExp,
+                        numPlanes,planes,outtype,outfile)) {
+      exit(1);
     }
 
-    // shift power spectrum
-    if (noiseColor != white || useInputExponent || numPlanes > 0) {
-
-      // generate the complex frequency spectrum
-      void* interim = decompose3D(data,n[0],n[1],n[2]);
 
-      // shift it to color the noise
-      shiftPowerSpectrum3D(interim,n[0],n[1],n[2],longestWavelength,shortestWavelength,powerExp);
+  //-------------------------------------------------------------------------
+  } else if (numDims == 3 && scratchFile) {
+
+    // stream the volume through a scratch file, slab by slab
+    const size_t nn[3] = {n[0], n[1], n[2]};
+    if (makeNoise3DOutOfCore(scratchFile,nn,generator,randSeedVal,
+                             noisePdf == Gaussian,colored,
+                             longestWavelength,shortestWavelength,powerExp,
+                             numPlanes,planes,outtype,outfile)) {
+      exit(1);
+    }
 
-      // add spikes emanating from the origin in f space
-      // NOT DONE
-      //addPlanesToSpectrum3D(interim,n[0],n[1],n[2],numPlanes,planes);
 
-      // reconstitute the signal
-      reproject3D(interim,n[0],n[1],n[2],data);
+  //-------------------------------------------------------------------------
+  } else {
+
+    // the whole 2D or 3D field, made in place in the context, where
+    // the spectrum can also be saved, read, or cut into mipmaps
+    STILLSPECTRUM spec;
+    spec.numDims = numDims;
+    spec.n = n;
+    spec.spectrumOut = spectrumOut;
+    spec.seed = randSeedVal;
+    spec.gaussian = (noisePdf == Gaussian);
+    spec.generator = generator;
+    spec.synthesized = synthesize;
+    spec.numLevels = numLevels;
+    spec.zeroMean = zeroMean;
+    spec.outtype = outtype;
+    spec.outfile = outfile;
+    spec.levelsFailed = FALSE;
+
+    NGHOOKS hooks;
+    hooks.loadSpectrum = spectrumIn;
+    hooks.unshaped = spectrumOut ? saveUnshaped : NULL;
+    hooks.shaped = (numLevels > 1) ? writeLevels : NULL;
+    hooks.user = &spec;
+
+    ctx = ng_create();
+    if (!ctx) exit(1);
+    data = ng_generate_inplace(ctx, numDims, &still, &hooks);
+    if (!data) exit(1);
+
+    // look up the points while the grid is still here; their answers
+    // go to stdout, so the grid only goes to a file
+    if (queryFile) {
+      NOISEGRID grid;
+      initGrid(&grid,numDims,n,data);
+      if (answerQueries(&grid,interpolation,queryFile)) exit(1);
     }
 
     // write resulting data
-    writeData3D (outtype, outfile, data, n[0], n[1], n[2]);
+    if (outfile || !queryFile) {
+      const int failed = (numDims == 2) ?
+          writeData2D(outtype, outfile, data, n[0], n[1]) :
+          writeData3D(outtype, outfile, data, n[0], n[1], n[2]);
+      if (failed) exit(1);
+    }
+    if (spec.levelsFailed) exit(1);
   }
 
 
   //-------------------------------------------------------------------------
   // echo a summary of the contents of the output data
-  if (totalN > (float)(UINT32_MAX)) 
-    fprintf(stderr,"Created %g data points\n",totalN);
-  else
-    fprintf(stderr,"Created %d data points\n",(uint32_t)totalN);
-
-  // all's well?
-  exit(0);
-}
-
-
-//
-// Do a simple blur in physical space
-//
-void blur2D(float *data, size_t nx, size_t ny) {
+  if (mpiRank == 0) {
+    fprintf(stderr,"Created %zu data points\n",totalN*count*frames);
 
-  // a temporary array
-  float* temp = (float*)malloc(sizeof(float)*nx*ny);
+    // keep any newly-measured plans for next time
+    (void) saveWisdom(wisdomFile);
+  }
+  ng_destroy(ctx);
 
-  // how many iterations?
-  for (size_t iter=0; iter<10; iter++) {
+#ifdef USE_MPI
+  endDistributed();
+#endif
 
-    // loop over internal pixels only
-    for (size_t i=0; i<nx*ny; i++) temp[i] = data[i];
-    for (size_t i=1; i<nx-1; i++) {
-      for (size_t j=1; j<ny-1; j++) {
-        size_t idx = i*ny + j;
-        data[idx] += (temp[idx+1]+temp[idx-1]+temp[idx+ny]+temp[idx-ny]-4.*temp[idx]) / 16.0;
-      }
-    }
-  }
-  free(temp);
-  return;
+  // all's well?
+  exit(0);
 }
 
 
@@ -424,9 +800,93 @@ int Usage(char progname[255], int status) {
   "                                                                           ",
   "   -seed [int]  use the given random seed, otherwise seed is fixed         ",
   "                                                                           ",
+  "   -engine [fft|stream|iir]  for 1D, transform the whole signal at once,   ",
+  "               filter white noise block by block through an FIR kernel     ",
+  "               made from the spectrum, or run it through recursive         ",
+  "               filters sample by sample with no latency; stream and iir    ",
+  "               signals can be any length, and -n 0 runs until stopped;     ",
+  "               they always use -philox; supported formats: txt raw;        ",
+  "               iir ignores -long and -short; default=fft                   ",
+  "                                                                           ",
+  "   -block [int]  samples per streamed block, smaller for less latency,     ",
+  "               larger for more speed; default=4096                         ",
+  "                                                                           ",
+  "   -taps [int]  length of the streaming FIR kernel, or width of the        ",
+  "               square -tile one, which sets the longest wavelength         ",
+  "               that gets colored, also for iir; default=4096, or 256       ",
+  "               for -tile                                                   ",
+  "                                                                           ",
+  "   -tile x y   make only the 2D tile of an endless noise field whose       ",
+  "               first point is at x y; -n sets its size, and tiles join     ",
+  "               without seams, whatever order they are made in; always      ",
+  "               uses -philox                                                ",
+  "                                                                           ",
+  "   -channels [int]  number of independent iir signals, written as one      ",
+  "               frame of values per sample; default=1                       ",
+  "                                                                           ",
+  "   -count [int]  make this many realizations, using seeds seed, seed+1,    ",
+  "               and so on, and writing out_0000.png, out_0001.png, ...      ",
+  "               for -o out.png; 2D and 3D ones are transformed in batches   ",
+  "                                                                           ",
+  "   -frames [int]  make this many frames of 2D or 3D noise that evolves     ",
+  "               smoothly, written as out_0000.png, out_0001.png, ... for    ",
+  "               -o out.png; frame 0 is the still image                      ",
+  "                                                                           ",
+  "   -query name  after making a 2D or 3D grid, read points from this file,  ",
+  "               one per line in grid units, and write each with its value   ",
+  "               to stdout; the grid wraps around, and is only written if    ",
+  "               -o is given                                                 ",
+  "                                                                           ",
+  "   -cubic      interpolate -query points with Catmull-Rom cubics instead   ",
+  "               of linearly                                                 ",
+  "                                                                           ",
+  "   -levels [int]  number of mipmap levels for 2D and 3D; for -o out.png    ",
+  "               the full size goes to out.png and each coarser level, half  ",
+  "               the size of the one before, to out_0001.png, ...; all are   ",
+  "               cut from the one spectrum, so they agree with each other    ",
+  "                                                                           ",
+  "   -rate [float]  how far each frame moves, as the phase turn in radians   ",
+  "               of the longest waves; shorter ones turn faster, as the      ",
+  "               square root of wavenumber; default=0.2                      ",
+  "                                                                           ",
+  "   -spectral   for colored 2D and 3D noise, generate the random spectrum   ",
+  "               directly instead of transforming white noise; saves one     ",
+  "               FFT, output statistics are Gaussian for either -u or -g     ",
+  "                                                                           ",
   "   -lib        use C standard library random number generator instead      ",
   "               of mt19937 from std::random                                 ",
   "                                                                           ",
+  "   -philox     use the counter-based Philox4x32 generator, whose output    ",
+  "               does not depend on the number of threads; this is the       ",
+  "               default for 2D and 3D when -threads is above 1              ",
+  "                                                                           ",
+  "   -threads [int]  number of threads to use for random numbers and FFTs;   ",
+  "               with -serve, the number of requests answered at once;       ",
+  "               with -jobs, the number of small jobs run at once            ",
+  "               default=number of cores                                     ",
+  "                                                                           ",
+  "   -plan [estimate|measure|patient|exhaustive]  FFTW planner effort; more  ",
+  "               effort finds faster transforms but takes longer to plan,    ",
+  "               so use with -wisdom; default=estimate                       ",
+  "                                                                           ",
+  "   -serve path  stay up and answer requests on this UNIX domain socket,    ",
+  "               each a uint32 byte count and then options as given here     ",
+  "               (-d -n -u -g -seed -philox -e, the colors, -long -short     ",
+  "               -p -spectral -zero -o); the answer is a header (see         ",
+  "               server.h) and then the floats, unless -o named a file to    ",
+  "               write; plans and buffers stay warm; the socket is only      ",
+  "               open to its owner, as requests may write to any file the    ",
+  "               server can, and 2D and 3D ones follow -threads in using     ",
+  "               -philox as the command line does; stop with SIGINT          ",
+  "                                                                           ",
+  "   -jobs name  run every job in this file, one per line in the same words  ",
+  "               as -serve takes, each with its own -o; jobs of 4M points    ",
+  "               or more run one at a time on all threads, and the rest run  ",
+  "               side by side, one thread each; # starts a comment           ",
+  "                                                                           ",
+  "   -wisdom name  read FFTW plans from this file, if it exists, and write   ",
+  "               them back out when done                                     ",
+  "                                                                           ",
   "   -p x y z width strength                                                 ",
   "               adds a preference plane to the output, x,y,z is the         ",
   "               plane normal, width specifies the arc width in the          ",
@@ -437,6 +897,23 @@ int Usage(char progname[255], int status) {
   "               is useful only in 2D and 3D output, and can be entered      ",
   "               multiple times                                              ",
   "                                                                           ",
+  "   -save-spectrum name  keep the white noise spectrum of a 2D or 3D run,   ",
+  "               before any coloring, in this file                           ",
+  "                                                                           ",
+  "   -load-spectrum name  start from a saved spectrum instead of new noise;  ",
+  "               sizes come from the file, and only the coloring options     ",
+  "               (-e, colors, -long, -short, -p) matter, so each new look    ",
+  "               costs one shaping pass and one inverse FFT                  ",
+  "                                                                           ",
+  "   -ooc name   make 3D noise through a memory-mapped scratch file of this  ",
+  "               name, for volumes larger than memory; needs about           ",
+  "               8*nx*ny*(nz/2+1) bytes of disk, always uses -philox, and    ",
+  "               ignores -spectral; supported formats: txt raw bob bos       ",
+  "                                                                           ",
+  "   When built with USE_MPI, 2D and 3D runs under mpirun split the domain   ",
+  "   into one slab per rank and always use -philox; raw, bob, and bos        ",
+  "   files are written in parallel, other formats are gathered on rank 0     ",
+  "                                                                           ",
   "   -o name     specify output file name AND format;                        ",
   "               supported formats: txt raw png bob bos                      ",
   " ",
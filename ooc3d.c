@@ -0,0 +1,267 @@
+/*
+ * ooc3d.c - part of noisegen
+ *
+ * Make 3D noise volumes larger than memory. The r2c spectrum lives in
+ * a memory-mapped scratch file as x-slabs of ny*(nz/2+1) complex values.
+ * The forward transform is a 2D r2c per slab, then blocks of whole
+ * y-rows are gathered from every slab so that the x-transforms,
+ * the spectral filter, and the inverse x-transforms can all be done
+ * while the block is in memory. A 2D c2r per slab finishes the job.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// mmap, posix_fallocate, and madvise are POSIX, hidden by -std=c99
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "filter.h"
+#include "output3d.h"
+#include "ooc3d.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+//
+// Widen the running range to cover this slab
+//
+static void slabRange (const float* slab, const size_t ns, float* datmin, float* datmax) {
+  for (size_t i=0; i<ns; i++) {
+    if (slab[i] < *datmin) *datmin = slab[i];
+    if (slab[i] > *datmax) *datmax = slab[i];
+  }
+}
+
+
+/*
+ * Generate, color, and write a 3D noise volume through the scratch
+ * file, using about two slabs and one pencil block of memory; the
+ * generator must be able to start at any offset (philox)
+ */
+int makeNoise3DOutOfCore (const char* scratchFile, const size_t* n,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const OUTFF outtype, char* outfile) {
+
+  const size_t nx = n[0];
+  const size_t ny = n[1];
+  const size_t nz = n[2];
+  const size_t nzc = nz/2+1;
+  const size_t ns = ny*nz;
+  // one slab of the spectrum, or of the padded real signal
+  const size_t slabComplex = ny*nzc;
+  const size_t totalBytes = nx*slabComplex*sizeof(fftwf_complex);
+
+  // make and map the scratch file
+  int fd = open(scratchFile, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    fprintf(stderr,"ERROR (makeNoise3DOutOfCore): could not open %s\n",scratchFile);
+    return(1);
+  }
+  // reserve every block now, since running out of disk later, through
+  // the mapping, would be a SIGBUS rather than an error
+  if (posix_fallocate(fd, 0, (off_t)totalBytes) != 0) {
+    fprintf(stderr,"ERROR (makeNoise3DOutOfCore): could not reserve %zu bytes for %s\n",
+            totalBytes,scratchFile);
+    close(fd);
+    unlink(scratchFile);
+    return(1);
+  }
+  void* map = mmap(NULL, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    fprintf(stderr,"ERROR (makeNoise3DOutOfCore): could not map %s\n",scratchFile);
+    close(fd);
+    unlink(scratchFile);
+    return(1);
+  }
+  fftwf_complex* vol = (fftwf_complex*)map;
+
+  float* slab = (float*) fftwf_malloc(2*slabComplex*sizeof(float));
+  if (!slab) {
+    fprintf(stderr,"ERROR (makeNoise3DOutOfCore): could not allocate a slab\n");
+    munmap(map, totalBytes);
+    close(fd);
+    unlink(scratchFile);
+    return(1);
+  }
+
+  FILE* ofh = beginData3D(outtype, outfile, nx, ny, nz);
+  if (!ofh) {
+    fftwf_free(slab);
+    munmap(map, totalBytes);
+    close(fd);
+    unlink(scratchFile);
+    return(1);
+  }
+
+  // byte and short bricks are scaled by the range of the whole volume
+  const BOOL needRange = (outtype == bob || outtype == bos);
+  float datmin = FLT_MAX;
+  float datmax = -FLT_MAX;
+
+  const ptrdiff_t sdims[2] = {(ptrdiff_t)ny, (ptrdiff_t)nz};
+
+  // forward pass: white noise, then r2c, one slab at a time
+  int failed = 0;
+  (void) madvise(map, totalBytes, MADV_SEQUENTIAL);
+  for (size_t i=0; i<nx && !failed; i++) {
+    if (gaussian) {
+      getRandomGaussianAt(generator,randSeed,i*ns,slab,ns,0.0,1.0);
+    } else {
+      getRandomUniformAt(generator,randSeed,i*ns,slab,ns,-1.0,1.0);
+    }
+
+    if (colored) {
+      padRealArray(slab, ny, nz);
+      if (executeR2C(2, sdims, slab, (fftwf_complex*)slab)) {
+        failed = 1;
+        break;
+      }
+      memcpy(vol + i*slabComplex, slab, slabComplex*sizeof(fftwf_complex));
+    } else if (needRange) {
+      slabRange(slab, ns, &datmin, &datmax);
+      memcpy(vol + i*slabComplex, slab, ns*sizeof(float));
+    } else if (writeSlab3D(outtype, ofh, slab, i, ny, nz, 0.0, 0.0)) {
+      failed = 1;
+      break;
+    }
+  }
+
+  if (colored && !failed) {
+
+    // the same filter as in core, 1/N included
+    NOISEFILTER nf;
+    const BOOL haveFilter = !makeNoiseFilter(&nf, 3, n, 1.0/((float)nx*(float)ny*(float)nz),
+                                             longestWavelength, shortestWavelength, exponent,
+                                             numPlanes, pp);
+    if (!haveFilter) failed = 1;
+
+    // as many whole y-rows per block as fit in the budget
+    size_t rowsPerBlock = OOCBLOCKBYTES / (nx*nzc*sizeof(fftwf_complex));
+    if (rowsPerBlock < 1) rowsPerBlock = 1;
+    if (rowsPerBlock > ny) rowsPerBlock = ny;
+    fftwf_complex* block = (fftwf_complex*)
+        fftwf_malloc(nx*rowsPerBlock*nzc*sizeof(fftwf_complex));
+    if (!block) {
+      fprintf(stderr,"ERROR (makeNoise3DOutOfCore): could not allocate a pencil block\n");
+      failed = 1;
+    }
+
+    // pencil pass: gather, transform along x, filter, transform back,
+    // and scatter; each slab contributes one contiguous run per block
+    (void) madvise(map, totalBytes, MADV_NORMAL);
+    for (size_t j0=0; j0<ny && !failed; j0+=rowsPerBlock) {
+      const size_t nj = (ny-j0 < rowsPerBlock) ? ny-j0 : rowsPerBlock;
+      const size_t run = nj*nzc;
+
+      for (size_t i=0; i<nx; i++) {
+        memcpy(block + i*run, vol + i*slabComplex + j0*nzc, run*sizeof(fftwf_complex));
+      }
+
+      if (executeManyC2C((ptrdiff_t)nx, (ptrdiff_t)run, block, FFTW_FORWARD)) {
+        failed = 1;
+        break;
+      }
+
+      const size_t lo[2] = {0, j0};
+      const size_t cnt[2] = {nx, nj};
+      if (applyFilterBlock(block, &nf.filter, lo, cnt)) {
+        failed = 1;
+        break;
+      }
+
+      if (executeManyC2C((ptrdiff_t)nx, (ptrdiff_t)run, block, FFTW_BACKWARD)) {
+        failed = 1;
+        break;
+      }
+
+      for (size_t i=0; i<nx; i++) {
+        memcpy(vol + i*slabComplex + j0*nzc, block + i*run, run*sizeof(fftwf_complex));
+      }
+    }
+
+    if (block) fftwf_free(block);
+    if (haveFilter) freeNoiseFilter(&nf);
+
+    // inverse pass: c2r each slab, and keep it if the range is needed
+    (void) madvise(map, totalBytes, MADV_SEQUENTIAL);
+    for (size_t i=0; i<nx && !failed; i++) {
+      memcpy(slab, vol + i*slabComplex, slabComplex*sizeof(fftwf_complex));
+      if (executeC2R(2, sdims, (fftwf_complex*)slab, slab)) {
+        failed = 1;
+        break;
+      }
+      unpadRealArray(slab, ny, nz, 1.0);
+
+      if (needRange) {
+        slabRange(slab, ns, &datmin, &datmax);
+        memcpy(vol + i*slabComplex, slab, ns*sizeof(float));
+      } else if (writeSlab3D(outtype, ofh, slab, i, ny, nz, 0.0, 0.0)) {
+        failed = 1;
+        break;
+      }
+    }
+  }
+
+  // output pass, only for the scaled formats
+  if (needRange && !failed) {
+    for (size_t i=0; i<nx && !failed; i++) {
+      if (writeSlab3D(outtype, ofh, (float*)(vol + i*slabComplex), i, ny, nz, datmin, datmax)) {
+        failed = 1;
+      }
+    }
+  }
+
+  if (endData3D(ofh, outfile)) failed = 1;
+  fftwf_free(slab);
+
+  // the scratch file is only scratch
+  munmap(map, totalBytes);
+  close(fd);
+  unlink(scratchFile);
+
+  return(failed);
+}
+
+#else
+
+int makeNoise3DOutOfCore (const char* scratchFile, const size_t* n,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const OUTFF outtype, char* outfile) {
+  fprintf(stderr,"ERROR (makeNoise3DOutOfCore): not supported on this platform\n");
+  return(1);
+}
+
+#endif
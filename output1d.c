@@ -23,32 +23,90 @@
 #include <stdio.h>
 #include "output1d.h"
 
-void writeData1D (OUTFF type, char* outfile, float *outdata, size_t n) {
+int writeData1D (OUTFF type, char* outfile, float *outdata, size_t n) {
+
+  if (type == wav) {
+    fprintf(stderr,"ERROR (writeData1D): output file type .wav unsupported.\n");
+    return(1);
+  } else if (type != raw && type != text) {
+    fprintf(stderr,"ERROR (writeData1D): output file type unsupported.\n");
+    return(1);
+  }
 
   // output handle defaults to stdout
   FILE* ofh = stdout;
+  if (outfile) ofh = fopen(outfile, (type == text) ? "w" : "wb");
+  if (!ofh) {
+    fprintf(stderr,"ERROR (writeData1D): could not open %s\n",outfile);
+    return(1);
+  }
 
   // write the resulting signal to the output file handle using the proper file type
   if (type == raw) {
-    if (outfile) ofh = fopen(outfile,"wb");
     fwrite(outdata,sizeof(float),n,ofh);
-    if (outfile) fclose(ofh);
 
-  } else if (type == text) {
-    if (outfile) ofh = fopen(outfile,"w");
+  } else {
     for (size_t i=0; i<n; i++)
-      fprintf(ofh,"%d %g\n",(int)i,outdata[i]);
-    if (outfile) fclose(ofh);
+      fprintf(ofh,"%zu %g\n",i,outdata[i]);
+  }
 
-  } else if (type == wav) {
-    fprintf(stderr,"ERROR (writeData1D): output file type .wav unsupported.\n");
+  return endData1D(ofh, outfile);
+}
 
-  } else {
-    fprintf(stderr,"ERROR (writeData1D): output file type unsupported.\n");
+//
+// Open a 1D stream for writing block by block; only formats that
+// need no length up front can be streamed
+//
+FILE* beginData1D (OUTFF type, char* outfile) {
 
+  if (type != raw && type != text) {
+    fprintf(stderr,"ERROR (beginData1D): output file type unsupported for streaming.\n");
+    return NULL;
   }
 
-  return;
+  // output handle defaults to stdout
+  FILE* ofh = stdout;
+  if (outfile) ofh = fopen(outfile, (type == text) ? "w" : "wb");
+  if (!ofh) {
+    fprintf(stderr,"ERROR (beginData1D): could not open %s\n",outfile);
+    return NULL;
+  }
+  return ofh;
+}
+
+//
+// Write samples first..first+n-1 of the stream, each a frame of one
+// value per channel; nonzero once the stream has failed to write
+//
+int writeBlock1D (OUTFF type, FILE* ofh, float *block, size_t first, size_t n,
+    size_t channels) {
+
+  if (type == raw) {
+    fwrite(block,sizeof(float),n*channels,ofh);
+
+  } else if (type == text) {
+    for (size_t i=0; i<n; i++) {
+      fprintf(ofh,"%zu",first+i);
+      for (size_t c=0; c<channels; c++) fprintf(ofh," %g",block[i*channels+c]);
+      fprintf(ofh,"\n");
+    }
+  }
+
+  return ferror(ofh);
+}
+
+//
+// Close or flush the stream; return 1 if any of it failed to write
+//
+int endData1D (FILE* ofh, char* outfile) {
+  int failed = ferror(ofh);
+  if (outfile) failed |= (fclose(ofh) != 0);
+  else failed |= (fflush(ofh) != 0);
+  if (failed) {
+    fprintf(stderr,"ERROR (endData1D): could not write %s\n",outfile ? outfile : "to stdout");
+    return(1);
+  }
+  return(0);
 }
 
 void writeSpectrum1D (OUTFF type, char* outfile, float *outdata, size_t n) {
@@ -26,6 +26,9 @@
 #include <stdint.h>
 #include "output.h"
 
-void writeData1D (OUTFF, char*, float*, size_t);
+int writeData1D (OUTFF, char*, float*, size_t);
+FILE* beginData1D (OUTFF, char*);
+int writeBlock1D (OUTFF, FILE*, float*, size_t, size_t, size_t);
+int endData1D (FILE*, char*);
 void writeSpectrum1D (OUTFF, char*, float*, size_t);
 
@@ -31,35 +31,42 @@ int writePng (char*, float*, size_t, size_t);
 png_byte** allocate_2d_array_pb (size_t,size_t,int);
 int free_2d_array_pb (png_byte**);
 
-void writeData2D (OUTFF type, char* outfile, float *outdata,
+int writeData2D (OUTFF type, char* outfile, float *outdata,
     size_t nx, size_t ny) {
 
+  // the png writer opens its own file
+  if (type == png) {
+    return (writePng(outfile,outdata,nx,ny) == 0) ? 0 : 1;
+  } else if (type != raw && type != text) {
+    fprintf(stderr,"ERROR (writeData2D): output file type unsupported.\n");
+    return(1);
+  }
+
   // output handle defaults to stdout
   FILE* ofh = stdout;
+  if (outfile) ofh = fopen(outfile, (type == text) ? "w" : "wb");
+  if (!ofh) {
+    fprintf(stderr,"ERROR (writeData2D): could not open %s\n",outfile);
+    return(1);
+  }
 
   // write the data to the output file handle using the proper file type
   if (type == raw) {
-
-    if (outfile) ofh = fopen(outfile,"wb");
     fwrite(outdata,sizeof(float),nx*ny,ofh);
-    if (outfile) fclose(ofh);
-
-  } else if (type == text) {
-
-    if (outfile) ofh = fopen(outfile,"w");
-    for (size_t i=0; i<nx*ny; i++)
-      fprintf(ofh,"%d %d %g\n",(int)(i/ny),(int)(i%ny),outdata[i]);
-    if (outfile) fclose(ofh);
-
-  } else if (type == png) {
-
-    (void) writePng(outfile,outdata,nx,ny);
 
   } else {
-    fprintf(stderr,"ERROR (writeData2D): output file type unsupported.\n");
+    for (size_t i=0; i<nx*ny; i++)
+      fprintf(ofh,"%zu %zu %g\n",i/ny,i%ny,outdata[i]);
   }
 
-  return;
+  int failed = ferror(ofh);
+  if (outfile) failed |= (fclose(ofh) != 0);
+  else failed |= (fflush(ofh) != 0);
+  if (failed) {
+    fprintf(stderr,"ERROR (writeData2D): could not write %s\n",outfile ? outfile : "to stdout");
+    return(1);
+  }
+  return(0);
 }
 
 
@@ -72,7 +79,8 @@ void writeData2D (OUTFF type, char* outfile, float *outdata,
 int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
 
   int autorange = 1; // true
-  int i,j,printval;
+  size_t i,j;
+  int printval;
   int bit_depth = 16;
   float newminrange,newmaxrange;
   float valmin,valrange;
@@ -89,6 +97,12 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
 
   fprintf(stderr,"Writing %s\n",outfilename);
 
+  // the format itself stops at 2^31-1 on a side
+  if (nx > PNG_UINT_31_MAX || ny > PNG_UINT_31_MAX) {
+    fprintf(stderr,"ERROR (writePng): image is too large for png\n");
+    return (-1);
+  }
+
   // allocate the space for the byte array
   // this is one place where we switch x and y
   img = allocate_2d_array_pb(ny,nx,bit_depth);
@@ -118,7 +132,8 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
     if (fp==NULL) {
       fprintf(stderr,"Could not open output file %s\n",outfilename);
       fflush(stderr);
-      exit(0);
+      free_2d_array_pb(img);
+      return (-1);
     }
   }
 
@@ -164,7 +179,7 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
     if (outfilename) fclose(fp);
     fprintf(stderr,"Could not create png struct\n");
     fflush(stderr);
-    exit(0);
+    free_2d_array_pb(img);
     return (-1);
   }
 
@@ -173,6 +188,7 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
   if (info_ptr == NULL) {
     if (outfilename) fclose(fp);
     png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
+    free_2d_array_pb(img);
     return (-1);
   }
 
@@ -183,6 +199,7 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
     /* If we get here, we had a problem reading the file */
     if (outfilename) fclose(fp);
     png_destroy_write_struct(&png_ptr, &info_ptr);
+    free_2d_array_pb(img);
     return (-1);
   }
 
@@ -219,12 +236,13 @@ int writePng (char *outfilename, float *outdata, size_t nx, size_t ny) {
   png_destroy_write_struct(&png_ptr, &info_ptr);
 
   // close file
-  if (outfilename) fclose(fp);
+  const int failed = (outfilename && fclose(fp) != 0);
+  if (failed) fprintf(stderr,"Could not write output file %s\n",outfilename);
 
   // free the data array
   free_2d_array_pb(img);
 
-  return 0;
+  return failed ? -1 : 0;
 }
 
 /*
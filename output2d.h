@@ -26,5 +26,5 @@
 #include <stdint.h>
 #include "output.h"
 
-void writeData2D (OUTFF, char*, float*, size_t, size_t);
+int writeData2D (OUTFF, char*, float*, size_t, size_t);
 
@@ -26,25 +26,22 @@
 #include <float.h>
 
 
-void writeData3D (OUTFF type, char* outfile, float *outdata,
+int writeData3D (OUTFF type, char* outfile, float *outdata,
     size_t nx, size_t ny, size_t nz) {
 
-  // output handle defaults to stdout
-  FILE* ofh = stdout;
+  // the header, if any, goes out as the file is opened
+  FILE* ofh = beginData3D(type, outfile, nx, ny, nz);
+  if (!ofh) return(1);
 
   // write the data to the output file handle using the proper file type
   if (type == raw) {
 
-    if (outfile) ofh = fopen(outfile,"wb");
     fwrite(outdata,sizeof(float),nx*ny*nz,ofh);
-    if (outfile) fclose(ofh);
 
   } else if (type == text) {
 
-    if (outfile) ofh = fopen(outfile,"w");
     for (size_t i=0; i<nx*ny*nz; i++)
-      fprintf(ofh,"%d %d %d %g\n",(int)(i/(ny*nz)),(int)((i/nz)%ny),(int)(i%nz),outdata[i]);
-    if (outfile) fclose(ofh);
+      fprintf(ofh,"%zu %zu %zu %g\n",i/(ny*nz),(i/nz)%ny,i%nz,outdata[i]);
 
   } else if (type == bob) {
 
@@ -57,23 +54,19 @@ void writeData3D (OUTFF type, char* outfile, float *outdata,
     }
     // scale the data to the range of a byte
     char* brick = (char*) malloc(sizeof(char)*nx*ny*nz);
+    if (!brick) {
+      fprintf(stderr,"ERROR (writeData3D): could not allocate the bricks\n");
+      (void) endData3D(ofh, outfile);
+      return(1);
+    }
     for (size_t i=0; i<nx*ny*nz; i++)
       brick[i] = (char)(255.999 * (outdata[i]-datmin) / (datmax-datmin));
 
-    if (outfile) ofh = fopen(outfile,"wb");
-    uint32_t outputRes = nx;
-    fwrite(&outputRes,sizeof(uint32_t),1,ofh);
-    outputRes = ny;
-    fwrite(&outputRes,sizeof(uint32_t),1,ofh);
-    outputRes = nz;
-    fwrite(&outputRes,sizeof(uint32_t),1,ofh);
     // then write the data
     fwrite(brick,sizeof(char),nx*ny*nz,ofh);
-    if (outfile) fclose(ofh);
-
     free(brick);
 
-  } else if (type == bos) {
+  } else {
 
     // find the min/max
     float datmin = FLT_MAX;
@@ -84,26 +77,110 @@ void writeData3D (OUTFF type, char* outfile, float *outdata,
     }
     // scale the data to the range of a byte
     uint16_t* brick = (uint16_t*) malloc(sizeof(uint16_t)*nx*ny*nz);
+    if (!brick) {
+      fprintf(stderr,"ERROR (writeData3D): could not allocate the bricks\n");
+      (void) endData3D(ofh, outfile);
+      return(1);
+    }
     for (size_t i=0; i<nx*ny*nz; i++)
       brick[i] = (uint16_t)(65535.9 * (outdata[i]-datmin) / (datmax-datmin));
 
-    if (outfile) ofh = fopen(outfile,"wb");
+    // then write the data
+    fwrite(brick,sizeof(uint16_t),nx*ny*nz,ofh);
+    free(brick);
+  }
+
+  return endData3D(ofh, outfile);
+}
+
+
+
+//
+// Open a 3D output file to be written one x-slab at a time,
+// and write any header
+//
+FILE* beginData3D (OUTFF type, char* outfile,
+    size_t nx, size_t ny, size_t nz) {
+
+  if (type != raw && type != text && type != bob && type != bos) {
+    fprintf(stderr,"ERROR (beginData3D): output file type unsupported.\n");
+    return NULL;
+  }
+
+  // output handle defaults to stdout
+  FILE* ofh = stdout;
+  if (outfile) ofh = fopen(outfile, (type == text) ? "w" : "wb");
+  if (!ofh) {
+    fprintf(stderr,"ERROR (beginData3D): could not open %s\n",outfile);
+    return NULL;
+  }
+
+  if (type == bob || type == bos) {
     uint32_t outputRes = nx;
     fwrite(&outputRes,sizeof(uint32_t),1,ofh);
     outputRes = ny;
     fwrite(&outputRes,sizeof(uint32_t),1,ofh);
     outputRes = nz;
     fwrite(&outputRes,sizeof(uint32_t),1,ofh);
-    // then write the data
-    fwrite(brick,sizeof(uint16_t),nx*ny*nz,ofh);
-    if (outfile) fclose(ofh);
+  }
+
+  return ofh;
+}
+
+//
+// Write x-slab number islab; bob and bos need the range of the
+// whole volume, so it must be known before the first slab; nonzero
+// once the file has failed to write
+//
+int writeSlab3D (OUTFF type, FILE* ofh, float *slab,
+    size_t islab, size_t ny, size_t nz,
+    float datmin, float datmax) {
+
+  const size_t ns = ny*nz;
 
+  if (type == raw) {
+    fwrite(slab,sizeof(float),ns,ofh);
+
+  } else if (type == text) {
+    for (size_t i=0; i<ns; i++)
+      fprintf(ofh,"%zu %zu %zu %g\n",islab,i/nz,i%nz,slab[i]);
+
+  } else if (type == bob) {
+    char* brick = (char*) malloc(sizeof(char)*ns);
+    if (!brick) {
+      fprintf(stderr,"ERROR (writeSlab3D): could not allocate a slab of bytes\n");
+      return(1);
+    }
+    for (size_t i=0; i<ns; i++)
+      brick[i] = (char)(255.999 * (slab[i]-datmin) / (datmax-datmin));
+    fwrite(brick,sizeof(char),ns,ofh);
     free(brick);
 
-  } else {
-    fprintf(stderr,"ERROR (writeData3D): output file type unsupported.\n");
+  } else if (type == bos) {
+    uint16_t* brick = (uint16_t*) malloc(sizeof(uint16_t)*ns);
+    if (!brick) {
+      fprintf(stderr,"ERROR (writeSlab3D): could not allocate a slab of shorts\n");
+      return(1);
+    }
+    for (size_t i=0; i<ns; i++)
+      brick[i] = (uint16_t)(65535.9 * (slab[i]-datmin) / (datmax-datmin));
+    fwrite(brick,sizeof(uint16_t),ns,ofh);
+    free(brick);
   }
 
-  return;
+  return ferror(ofh);
 }
 
+//
+// Close or flush the file; return 1 if any of it failed to write
+//
+int endData3D (FILE* ofh, char* outfile) {
+  int failed = ferror(ofh);
+  if (outfile) failed |= (fclose(ofh) != 0);
+  else failed |= (fflush(ofh) != 0);
+  if (failed) {
+    fprintf(stderr,"ERROR (endData3D): could not write %s\n",outfile ? outfile : "to stdout");
+    return(1);
+  }
+  return(0);
+}
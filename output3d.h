@@ -26,5 +26,8 @@
 #include <stdint.h>
 #include "output.h"
 
-void writeData3D (OUTFF, char*, float*, size_t, size_t, size_t);
+int writeData3D (OUTFF, char*, float*, size_t, size_t, size_t);
+FILE* beginData3D (OUTFF, char*, size_t, size_t, size_t);
+int writeSlab3D (OUTFF, FILE*, float*, size_t, size_t, size_t, float, float);
+int endData3D (FILE*, char*);
 
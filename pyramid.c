@@ -0,0 +1,142 @@
+/*
+ * pyramid.c - part of noisegen
+ *
+ * Write the levels of a mipmap pyramid, each half the size of the one
+ * before, by cutting the low frequencies out of the one full-size
+ * spectrum and running a smaller inverse transform. Every level is the
+ * band-limited downsample of the full-size noise, so they all agree,
+ * and in 2D all of them together cost about a third of one full-size
+ * inverse transform.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "output2d.h"
+#include "output3d.h"
+#include "ensemble.h"
+#include "pyramid.h"
+
+
+//
+// Copy the bins of an m-sized spectrum out of the n-sized one, scaled;
+// the Nyquist bins of the smaller one have no partner, so they are
+// left out, which also keeps it Hermitian
+//
+static void truncateSpectrum (const uint8_t numDims, const size_t* n,
+    const fftwf_complex* in, const size_t* m, fftwf_complex* out,
+    const float factor) {
+
+  const uint8_t last = numDims-1;
+  const size_t nlc = n[last]/2+1;
+  const size_t mlc = m[last]/2+1;
+  size_t mrows = 1;
+  for (uint8_t d=0; d<last; d++) mrows *= m[d];
+
+  #pragma omp parallel for schedule(static)
+  for (size_t r=0; r<mrows; r++) {
+
+    // the matching row of the big spectrum, if there is one
+    size_t rem = r;
+    size_t src = 0;
+    size_t stride = 1;
+    BOOL nyquist = FALSE;
+    for (int d=last-1; d>=0; d--) {
+      const size_t i = rem % m[d];
+      rem /= m[d];
+      if (2*i == m[d]) nyquist = TRUE;
+      src += ((2*i < m[d]) ? i : n[d]-(m[d]-i)) * stride;
+      stride *= n[d];
+    }
+
+    fftwf_complex* row = out + r*mlc;
+    const fftwf_complex* srow = in + src*nlc;
+    for (size_t j=0; j<mlc; j++) {
+      if (nyquist || 2*j == m[last]) {
+        row[j][0] = 0.0;
+        row[j][1] = 0.0;
+      } else {
+        row[j][0] = factor*srow[j][0];
+        row[j][1] = factor*srow[j][1];
+      }
+    }
+  }
+}
+
+
+/*
+ * Write levels 1 to levels-1 of the pyramid from the full-size spectrum,
+ * which is left as it is; level l goes to out_000l.png for -o out.png,
+ * and factor is whatever the full-size inverse would be scaled by
+ */
+int writePyramid (const uint8_t numDims, const size_t* n, const void* spectrum,
+    const float factor, const size_t levels,
+    const BOOL zeroMean, const OUTFF outtype, const char* outfile) {
+
+  // one buffer, big enough for the first and largest coarser level
+  size_t m[MAXDIMS] = {1, 1, 1};
+  size_t padded = 2*((n[numDims-1]>>1)/2+1);
+  for (uint8_t d=0; d<numDims-1; d++) padded *= n[d]>>1;
+  float* data = (float*) fftwf_malloc(padded*sizeof(float));
+  if (!data) {
+    fprintf(stderr,"ERROR (writePyramid): could not allocate the levels\n");
+    return(1);
+  }
+
+  // a level that cannot be written fails the whole, but the others
+  // are still written
+  int failed = 0;
+  for (size_t l=1; l<levels; l++) {
+    size_t mtotal = 1;
+    for (uint8_t d=0; d<numDims; d++) {
+      m[d] = n[d] >> l;
+      mtotal *= m[d];
+    }
+    const size_t mlast = m[numDims-1];
+    const ptrdiff_t dims[MAXDIMS] = {(ptrdiff_t)m[0], (ptrdiff_t)m[1], (ptrdiff_t)m[2]};
+
+    // the low frequencies only, then back to real space
+    truncateSpectrum(numDims, n, (const fftwf_complex*)spectrum, m,
+                     (fftwf_complex*)data, factor);
+    if (executeC2R(numDims, dims, (fftwf_complex*)data, data)) {
+      fftwf_free(data);
+      return(1);
+    }
+    unpadRealArray(data, mtotal/mlast, mlast, 1.0);
+
+    // as for the full size, only 2D honors -zero
+    if (zeroMean && numDims == 2) normalizeInPlace(data, mtotal);
+
+    char name[255+16];
+    ensembleFileName(outfile, l, name);
+    if (numDims == 2) {
+      if (writeData2D(outtype, name, data, m[0], m[1])) failed = 1;
+    } else {
+      if (writeData3D(outtype, name, data, m[0], m[1], m[2])) failed = 1;
+    }
+  }
+
+  fftwf_free(data);
+  return(failed);
+}
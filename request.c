@@ -0,0 +1,205 @@
+/*
+ * request.c - part of noisegen
+ *
+ * A request is a line of the same options as the command line, for
+ * the ones that make a single field: sizes, generator, seed, color,
+ * band limits, planes, and an output file. Both the socket server and
+ * the batch runner read theirs with these.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "output1d.h"
+#include "output2d.h"
+#include "output3d.h"
+#include "request.h"
+
+
+//
+// Split text into words in place, as a shell would without quotes;
+// return the number of words, or -1 if there are too many
+//
+int splitRequest (char* text, char** argv) {
+  int argc = 0;
+  char* word = text;
+  while (TRUE) {
+    while (*word && isspace((int)*word)) word++;
+    if (!*word) break;
+    if (argc == MAXREQUESTWORDS) return(-1);
+    argv[argc++] = word;
+    while (*word && !isspace((int)*word)) word++;
+    if (*word) *word++ = '\0';
+  }
+  return(argc);
+}
+
+
+//
+// Turn the words of a request into parameters, with the same options
+// and defaults as the command line, including its choice of generator
+// for numThreads; return 1 and say why if they cannot be served
+//
+int parseRequest (const int argc, char** argv, const int numThreads, NGPARAMS* p,
+    uint8_t* numDims, PLANE* planes, char** outfile, char* why, BOOL* switched) {
+
+  ng_default_params(p);
+  p->n[0] = 100;
+  p->n[1] = 1;
+  p->n[2] = 1;
+  *numDims = 1;
+  *outfile = NULL;
+  BOOL colored = FALSE;
+  float colorExponent = 1.0;
+  BOOL useInputExponent = FALSE;
+  float inputExponent = 0.0;
+
+  for (int i=0; i<argc; i++) {
+    // how many values each option needs after it
+    const int need = (strcmp(argv[i], "-p") == 0) ? 5 :
+                     (strncmp(argv[i], "-d", 2) == 0 || strncmp(argv[i], "-n", 2) == 0 ||
+                      strncmp(argv[i], "-o", 2) == 0 || strncmp(argv[i], "-seed", 5) == 0 ||
+                      strncmp(argv[i], "-short", 3) == 0 || strncmp(argv[i], "-long", 3) == 0 ||
+                      strcmp(argv[i], "-e") == 0) ? 1 : 0;
+    if (i+need >= argc) {
+      sprintf(why,"option %.64s needs %d value(s)",argv[i],need);
+      return(1);
+    }
+
+    if (strncmp(argv[i], "-d", 2) == 0) {
+      *numDims = (uint8_t)atoi(argv[++i]);
+    } else if (strncmp(argv[i], "-n", 2) == 0) {
+      p->n[0] = (size_t)strtoull(argv[++i],NULL,10);
+      if (i+1 < argc && isdigit((int)argv[i+1][0])) {
+        p->n[1] = (size_t)strtoull(argv[++i],NULL,10);
+        if (i+1 < argc && isdigit((int)argv[i+1][0])) {
+          p->n[2] = (size_t)strtoull(argv[++i],NULL,10);
+        }
+      }
+    } else if (strncmp(argv[i], "-ooc", 4) == 0 || strncmp(argv[i], "-lib", 4) == 0) {
+      sprintf(why,"option %.64s is not available in requests",argv[i]);
+      return(1);
+    } else if (strncmp(argv[i], "-o", 2) == 0) {
+      *outfile = argv[++i];
+    } else if (strncmp(argv[i], "-zero", 2) == 0) {
+      p->zeroMean = TRUE;
+    } else if (strncmp(argv[i], "-philox", 3) == 0) {
+      p->generator = philox;
+    } else if (strncmp(argv[i], "-seed", 5) == 0) {
+      p->seed = atoi(argv[++i]);
+    } else if (strncmp(argv[i], "-spectral", 3) == 0) {
+      p->spectral = TRUE;
+    } else if (strncmp(argv[i], "-short", 3) == 0) {
+      p->shortestWavelength = (float)atof(argv[++i]);
+    } else if (strncmp(argv[i], "-long", 3) == 0) {
+      p->longestWavelength = (float)atof(argv[++i]);
+    } else if (strncmp(argv[i], "-red", 4) == 0 || strncmp(argv[i], "-brown", 5) == 0) {
+      colored = TRUE;
+      colorExponent = -2.0;
+    } else if (strncmp(argv[i], "-pink", 5) == 0) {
+      colored = TRUE;
+      colorExponent = -1.0;
+    } else if (strncmp(argv[i], "-white", 5) == 0) {
+      colored = FALSE;
+      colorExponent = 1.0;
+    } else if (strncmp(argv[i], "-blue", 5) == 0) {
+      colored = TRUE;
+      colorExponent = 1.0;
+    } else if (strncmp(argv[i], "-violet", 5) == 0) {
+      colored = TRUE;
+      colorExponent = 2.0;
+    } else if (strcmp(argv[i], "-e") == 0) {
+      inputExponent = (float)atof(argv[++i]);
+      useInputExponent = TRUE;
+    } else if (strncmp(argv[i], "-u", 2) == 0) {
+      p->gaussian = FALSE;
+    } else if (strncmp(argv[i], "-g", 2) == 0) {
+      p->gaussian = TRUE;
+    } else if (strcmp(argv[i], "-p") == 0) {
+      if (p->numPlanes == MAXPLANES) {
+        sprintf(why,"at most %d planes",MAXPLANES);
+        return(1);
+      }
+      PLANE* pp = &planes[p->numPlanes];
+      pp->vec[0] = (float)atof(argv[++i]);
+      pp->vec[1] = (float)atof(argv[++i]);
+      pp->vec[2] = (float)atof(argv[++i]);
+      pp->width = fabs(atof(argv[++i]));
+      pp->strength = (float)atof(argv[++i]);
+      p->numPlanes++;
+    } else {
+      sprintf(why,"option %.64s is not available in requests",argv[i]);
+      return(1);
+    }
+  }
+
+  // as on the command line, threads mean a generator that can be
+  // split up without changing the answer
+  *switched = FALSE;
+  if (numThreads > 1 && p->generator == mersenne && *numDims > 1) {
+    p->generator = philox;
+    *switched = TRUE;
+  }
+
+  // the color is a power-law exponent, and -e beats any color
+  p->colored = colored || useInputExponent;
+  p->exponent = useInputExponent ? inputExponent : colorExponent;
+  p->planes = planes;
+
+  if (*numDims < 1 || *numDims > SUPPORTEDDIMS) {
+    sprintf(why,"number of dimensions must be 1..%d",SUPPORTEDDIMS);
+    return(1);
+  }
+  size_t ntotal = 1;
+  for (uint8_t d=0; d<*numDims; d++) {
+    if (p->n[d] < 1 || p->n[d] > MAXREQUESTPOINTS) {
+      sprintf(why,"each size must be 1..%zu",MAXREQUESTPOINTS);
+      return(1);
+    }
+    ntotal *= p->n[d];
+    if (ntotal > MAXREQUESTPOINTS) {
+      sprintf(why,"at most %zu points per request",MAXREQUESTPOINTS);
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+//
+// Say that the same seed will give different noise than -threads 1
+//
+void noteSwitchedGenerator (const char* which) {
+  fprintf(stderr,"Using -philox for %s, as -threads is above 1; use -threads 1 for mt19937 noise\n",
+          which);
+}
+
+
+//
+// Write the answer to outfile, as the type its extension names;
+// return 1 if it could not be written
+//
+int writeRequest (const uint8_t numDims, const size_t* n, float* data, char* outfile) {
+  const OUTFF outtype = ng_output_type(outfile, text);
+  if (numDims == 1) return writeData1D(outtype, outfile, data, n[0]);
+  else if (numDims == 2) return writeData2D(outtype, outfile, data, n[0], n[1]);
+  else return writeData3D(outtype, outfile, data, n[0], n[1], n[2]);
+}
@@ -0,0 +1,36 @@
+/*
+ * request.h - part of noisegen
+ *
+ * Read one noise request, written as command-line options, into the
+ * parameters of the library; shared by -serve and -jobs
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "libnoisegen.h"
+
+// most words in one request, and most points it may ask for
+#define MAXREQUESTWORDS 256
+#define MAXREQUESTPOINTS ((size_t)1<<30)
+
+int splitRequest (char*, char**);
+int parseRequest (const int, char**, const int, NGPARAMS*, uint8_t*, PLANE*, char**, char*, BOOL*);
+void noteSwitchedGenerator (const char*);
+int writeRequest (const uint8_t, const size_t*, float*, char*);
@@ -25,16 +25,206 @@
 
 #include <random>
 #include <limits>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
 
 
-std::random_device rd;  // Will be used to obtain a seed for the random number engine
-std::mt19937 rng(rd()); // Standard mersenne_twister_engine seeded with rd()
+// Standard mersenne_twister_engine, reseeded before every use, so it
+// needs no random_device, and one per thread lets threads fill at once
+thread_local std::mt19937 rng;
+
+
+// number of Philox blocks (of four words each) made per batch
+#define RNGBATCH 16
+
+
+//
+// Philox4x32-10 counter-based generator (Salmon et al., SC11)
+// Four 32-bit outputs are a pure function of the 128-bit counter and
+// the 64-bit key, so any block of samples can be made independently.
+// Here RNGBATCH consecutive blocks run in lockstep so that the rounds
+// vectorize; block b holds the words for samples 4b..4b+3
+//
+static void philoxBatch (const int randSeed, const uint64_t b0, uint32_t* w) {
+
+  uint32_t c0[RNGBATCH], c1[RNGBATCH], c2[RNGBATCH], c3[RNGBATCH];
+  uint32_t k0 = (uint32_t)randSeed;
+  uint32_t k1 = 0;
+
+  #pragma omp simd
+  for (int l=0; l<RNGBATCH; l++) {
+    c0[l] = (uint32_t)(b0+l);
+    c1[l] = (uint32_t)((b0+l) >> 32);
+    c2[l] = 0;
+    c3[l] = 0;
+  }
+
+  for (int r=0; r<10; r++) {
+    #pragma omp simd
+    for (int l=0; l<RNGBATCH; l++) {
+      const uint64_t p0 = (uint64_t)0xD2511F53 * c0[l];
+      const uint64_t p1 = (uint64_t)0xCD9E8D57 * c2[l];
+      c0[l] = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+      c2[l] = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+      c1[l] = (uint32_t)p1;
+      c3[l] = (uint32_t)p0;
+    }
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+
+  for (int l=0; l<RNGBATCH; l++) {
+    w[4*l]   = c0[l];
+    w[4*l+1] = c1[l];
+    w[4*l+2] = c2[l];
+    w[4*l+3] = c3[l];
+  }
+}
+
+
+//
+// Branch-free natural log for x in (0,1], after the Cephes logf
+//
+static inline float batchLog (const float x) {
+
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(float));
+  float e = (float)((int32_t)((bits >> 23) & 0xff) - 126);
+  const uint32_t mant = bits & 0x007fffff;
+  bits = mant | 0x3f000000;
+  float m;
+  std::memcpy(&m, &bits, sizeof(float));
+
+  // m is now in [0.5,1), shift it to [sqrt(1/2)-1, sqrt(2)-1); the
+  // test on the mantissa bits is pure integer math so that GCC does
+  // not turn it back into a branch
+  const float low = (float)((mant - 0x003504f3u) >> 31);
+  e -= low;
+  m = (m - 1.0f) + low*m;
+
+  const float z = m*m;
+  float y = 7.0376836292e-2f;
+  y = y*m - 1.1514610310e-1f;
+  y = y*m + 1.1676998740e-1f;
+  y = y*m - 1.2420140846e-1f;
+  y = y*m + 1.4249322787e-1f;
+  y = y*m - 1.6668057665e-1f;
+  y = y*m + 2.0000714765e-1f;
+  y = y*m - 2.4999993993e-1f;
+  y = y*m + 3.3333331174e-1f;
+  y *= m*z;
+  y += -2.12194440e-4f*e - 0.5f*z;
+  return m + y + 0.693359375f*e;
+}
+
+//
+// Branch-free sine and cosine of 2*pi*u for u in [0,1]
+//
+static inline void batchSinCos2Pi (const float u, float* sn, float* cs) {
+
+  // reduce to a quarter turn q and a remainder in [-1/8,1/8] turns,
+  // truncation only sees positive values here so it acts as floor
+  const float r = u - (float)(int32_t)(u + 0.5f);
+  const int32_t qi = (int32_t)(4.0f*r + 2.5f) - 2;
+  const float x = (r - 0.25f*(float)qi) * 6.283185307179586f;
+  const int q = qi & 3;
+
+  // Cephes sinf and cosf polynomials on [-pi/4,pi/4]
+  const float z = x*x;
+  const float s = x + x*z*((-1.9515295891e-4f*z + 8.3321608736e-3f)*z - 1.6666654611e-1f);
+  const float c = 1.0f - 0.5f*z + z*z*((2.443315711809948e-5f*z - 1.388731625493765e-3f)*z + 4.166664568298827e-2f);
+
+  // rotate back by the quarter turns: swap on odd q, then flip signs
+  uint32_t sb, cb;
+  std::memcpy(&sb, &s, sizeof(float));
+  std::memcpy(&cb, &c, sizeof(float));
+  const uint32_t swap = 0u - (uint32_t)(q & 1);
+  uint32_t tsb = (cb & swap) | (sb & ~swap);
+  uint32_t tcb = (sb & swap) | (cb & ~swap);
+  tsb ^= (uint32_t)(q & 2) << 30;
+  tcb ^= (uint32_t)((q+1) & 2) << 30;
+  std::memcpy(sn, &tsb, sizeof(float));
+  std::memcpy(cs, &tcb, sizeof(float));
+}
+
+//
+// Convert raw words into uniform floats in (lower,lower+scale)
+//
+static void wordsToUniform (const uint32_t* w, float* out, const size_t n,
+    const float lower, const float scale) {
+
+  const float unit = scale * (1.0f/16777216.0f);
+  #pragma omp simd
+  for (size_t i=0; i<n; i++) {
+    out[i] = lower + unit*((float)(w[i] >> 8) + 0.5f);
+  }
+}
+
+//
+// Convert pairs of raw words into pairs of normals with Box-Muller
+//
+static void wordsToGaussian (const uint32_t* w, float* out, const size_t n,
+    const float mean, const float stddev) {
+
+  #pragma omp simd
+  for (size_t i=0; i<n/2; i++) {
+    // first word maps onto (0,1] so that the log is finite
+    const float u1 = (float)((w[2*i] >> 8) + 1) * (1.0f/16777216.0f);
+    const float u2 = (float)(w[2*i+1] >> 8) * (1.0f/16777216.0f);
+    const float rad = stddev * std::sqrt(-2.0f * batchLog(u1));
+    float sn, cs;
+    batchSinCos2Pi(u2, &sn, &cs);
+    out[2*i]   = mean + rad*cs;
+    out[2*i+1] = mean + rad*sn;
+  }
+}
+
+
+//
+// Fill samples offset..offset+n-1 of the philox stream; batches are
+// aligned to the start of the stream, so any split of a long stream
+// into pieces gives the same numbers as one call would
+//
+static void philoxFill (const int randSeed, const size_t offset,
+    float* first, const size_t n, const bool gaussian,
+    const float a, const float b) {
+
+  if (n == 0) return;
+  const size_t batch = 4*RNGBATCH;
+  const int64_t ib0 = (int64_t)(offset/batch);
+  const int64_t ib1 = (int64_t)((offset+n-1)/batch);
+
+  // every batch is independent, so the split over threads does not matter
+  #pragma omp parallel for schedule(static)
+  for (int64_t ib=ib0; ib<=ib1; ib++) {
+    uint32_t w[4*RNGBATCH];
+    float temp[4*RNGBATCH];
+
+    // the part of this batch that lands in the output
+    const size_t g0 = (size_t)ib*batch;
+    const size_t lo = (g0 < offset) ? offset-g0 : 0;
+    const size_t hi = (g0+batch > offset+n) ? offset+n-g0 : batch;
+
+    philoxBatch(randSeed, (uint64_t)ib*RNGBATCH, w);
+    float* dest = (lo == 0 && hi == batch) ? first+(g0-offset) : temp;
+    if (gaussian) {
+      wordsToGaussian(w, dest, batch, a, b);
+    } else {
+      wordsToUniform(w, dest, batch, a, b);
+    }
+    if (dest == temp) {
+      for (size_t i=lo; i<hi; i++) first[g0+i-offset] = temp[i];
+    }
+  }
+}
 
 
 //
 // Fill a block of floats with uniform random numbers
 //
-extern "C" int getRandomUniform (
+extern "C" size_t getRandomUniform (
     const RNG userng, const int randSeed,
     float* first, const size_t n,
     const float lower, const float upper) {
@@ -55,6 +245,9 @@ extern "C" int getRandomUniform (
     for (size_t i=0; i<n; i++) {
       first[i] = lower + scale*unit(rng);
     }
+
+  } else if (userng == philox) {
+    philoxFill(randSeed, 0, first, n, false, lower, scale);
   }
 
   return n;
@@ -63,7 +256,7 @@ extern "C" int getRandomUniform (
 //
 // Fill a block of floats with gaussian random numbers
 //
-extern "C" int getRandomGaussian (
+extern "C" size_t getRandomGaussian (
     const RNG userng, const int randSeed,
     float* first, const size_t n,
     const float mean, const float stddev) {
@@ -92,7 +285,47 @@ extern "C" int getRandomGaussian (
     for (size_t i=0; i<n; i++) {
       first[i] = mean + stddev*gaussian(rng);
     }
+
+  } else if (userng == philox) {
+    philoxFill(randSeed, 0, first, n, true, mean, stddev);
   }
 
   return n;
 }
+
+//
+// Fill a block of floats with samples offset..offset+n-1 of what
+// the functions above would make, only counter-based streams can
+// start anywhere but the beginning
+//
+extern "C" size_t getRandomUniformAt (
+    const RNG userng, const int randSeed, const size_t offset,
+    float* first, const size_t n,
+    const float lower, const float upper) {
+
+  if (userng == philox) {
+    philoxFill(randSeed, offset, first, n, false, lower, upper-lower);
+    return n;
+  } else if (offset == 0) {
+    return getRandomUniform(userng, randSeed, first, n, lower, upper);
+  }
+
+  fprintf(stderr,"ERROR (getRandomUniformAt): only philox can start at an offset\n");
+  return 0;
+}
+
+extern "C" size_t getRandomGaussianAt (
+    const RNG userng, const int randSeed, const size_t offset,
+    float* first, const size_t n,
+    const float mean, const float stddev) {
+
+  if (userng == philox) {
+    philoxFill(randSeed, offset, first, n, true, mean, stddev);
+    return n;
+  } else if (offset == 0) {
+    return getRandomGaussian(userng, randSeed, first, n, mean, stddev);
+  }
+
+  fprintf(stderr,"ERROR (getRandomGaussianAt): only philox can start at an offset\n");
+  return 0;
+}
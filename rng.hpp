@@ -23,18 +23,31 @@
 #ifdef __cplusplus
 #include <cstddef>
 #else
+#include <stddef.h>
 #include <stdint.h>
 #endif
 
-typedef enum randomNumberGeneratorType {library,mersenne} RNG;
+// library and mersenne are serial streams; philox is counter-based, so
+// sample i depends only on (seed,i) and may be filled in any order
+typedef enum randomNumberGeneratorType {library,mersenne,philox} RNG;
 
 #ifdef __cplusplus
 extern "C"
 #endif
-int getRandomUniform (const RNG, const int, float*, const size_t, const float, const float);
+size_t getRandomUniform (const RNG, const int, float*, const size_t, const float, const float);
 
 #ifdef __cplusplus
 extern "C"
 #endif
-int getRandomGaussian (const RNG, const int, float*, const size_t, const float, const float);
+size_t getRandomGaussian (const RNG, const int, float*, const size_t, const float, const float);
 
+
+#ifdef __cplusplus
+extern "C"
+#endif
+size_t getRandomUniformAt (const RNG, const int, const size_t, float*, const size_t, const float, const float);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+size_t getRandomGaussianAt (const RNG, const int, const size_t, float*, const size_t, const float, const float);
@@ -0,0 +1,246 @@
+/*
+ * sample.c - part of noisegen
+ *
+ * Answer batches of point queries on a generated grid that stays in
+ * memory, with linear or Catmull-Rom cubic interpolation and periodic
+ * wrap in every direction. Points go in blocks: the offsets and
+ * weights of every tap are worked out for a whole block first, then
+ * the taps are summed in loops over the block, whose loads through
+ * the offsets the compiler turns into gathers when it may use AVX2
+ * (USE_NATIVE_ARCH). Blocks are spread over the threads.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "sample.h"
+
+
+//
+// Point a grid at data of the given size
+//
+void initGrid (NOISEGRID* g, const uint8_t numDims, const size_t* n, const float* data) {
+  g->numDims = numDims;
+  for (uint8_t d=0; d<MAXDIMS; d++) g->n[d] = (d<numDims) ? n[d] : 1;
+  g->data = data;
+}
+
+
+//
+// Offsets into the data and weights of the taps along one axis, for
+// np points at coordinates x in grid units; the cubic taps are at
+// i-1..i+2 around the cell, the linear ones at i and i+1
+//
+static void axisTaps (const INTERP kind, const size_t n, const size_t stride,
+    const float* x, const size_t np,
+    size_t off[4][SAMPLEBLOCK], float wt[4][SAMPLEBLOCK]) {
+
+  const int lead = (kind == cubic) ? 1 : 0;
+  const int taps = (kind == cubic) ? 4 : 2;
+  const double dn = (double)n;
+
+  #pragma omp simd
+  for (size_t p=0; p<np; p++) {
+    // wrap into one period, in double so that big coordinates keep
+    // their fraction
+    const double xd = (double)x[p] - dn*floor((double)x[p]/dn);
+    size_t i = (size_t)xd;
+    if (i >= n) i = n-1;
+    const float t = (float)(xd - (double)i);
+
+    for (int k=0; k<taps; k++) {
+      off[k][p] = ((i + (size_t)k + n - (size_t)lead) % n) * stride;
+    }
+    if (kind == cubic) {
+      const float t2 = t*t;
+      const float t3 = t2*t;
+      wt[0][p] = 0.5*(-t3 + 2.0*t2 - t);
+      wt[1][p] = 0.5*(3.0*t3 - 5.0*t2 + 2.0);
+      wt[2][p] = 0.5*(-3.0*t3 + 4.0*t2 + t);
+      wt[3][p] = 0.5*(t3 - t2);
+    } else {
+      wt[0][p] = 1.0 - t;
+      wt[1][p] = t;
+    }
+  }
+}
+
+
+/*
+ * Interpolate the grid at count points, whose coordinates along axis d
+ * are pos[d][0..count-1] in grid units, into out
+ */
+void sampleGrid (const NOISEGRID* g, const INTERP kind, const size_t count,
+    const float* const* pos, float* out) {
+
+  const int taps = (kind == cubic) ? 4 : 2;
+  const float* data = g->data;
+
+  // row-major strides, and one tap of weight 1 on the unused axes
+  size_t stride[MAXDIMS];
+  stride[MAXDIMS-1] = 1;
+  for (int d=MAXDIMS-2; d>=0; d--) stride[d] = stride[d+1]*g->n[d+1];
+  int ntaps[MAXDIMS];
+  for (uint8_t d=0; d<MAXDIMS; d++) ntaps[d] = (d<g->numDims) ? taps : 1;
+
+  const size_t nblocks = (count + SAMPLEBLOCK-1) / SAMPLEBLOCK;
+
+  #pragma omp parallel for schedule(static)
+  for (size_t b=0; b<nblocks; b++) {
+    const size_t first = b*SAMPLEBLOCK;
+    const size_t np = (count-first < SAMPLEBLOCK) ? count-first : SAMPLEBLOCK;
+
+    size_t off[MAXDIMS][4][SAMPLEBLOCK];
+    float wt[MAXDIMS][4][SAMPLEBLOCK];
+    for (uint8_t d=0; d<MAXDIMS; d++) {
+      if (d < g->numDims) {
+        axisTaps(kind, g->n[d], stride[d], pos[d]+first, np, off[d], wt[d]);
+      } else {
+        for (size_t p=0; p<np; p++) {
+          off[d][0][p] = 0;
+          wt[d][0][p] = 1.0;
+        }
+      }
+    }
+
+    // sum the taps, a gather per tap across the block
+    float sum[SAMPLEBLOCK];
+    for (size_t p=0; p<np; p++) sum[p] = 0.0;
+    for (int a=0; a<ntaps[0]; a++) {
+      for (int c=0; c<ntaps[1]; c++) {
+        for (int e=0; e<ntaps[2]; e++) {
+          const size_t* o0 = off[0][a];
+          const size_t* o1 = off[1][c];
+          const size_t* o2 = off[2][e];
+          const float* w0 = wt[0][a];
+          const float* w1 = wt[1][c];
+          const float* w2 = wt[2][e];
+          #pragma omp simd
+          for (size_t p=0; p<np; p++) {
+            sum[p] += w0[p]*w1[p]*w2[p] * data[o0[p]+o1[p]+o2[p]];
+          }
+        }
+      }
+    }
+    for (size_t p=0; p<np; p++) out[first+p] = sum[p];
+  }
+}
+
+
+/*
+ * Read points from a text file, one per line with one coordinate per
+ * dimension, and write each with its value to stdout
+ */
+int answerQueries (const NOISEGRID* g, const INTERP kind, const char* queryFile) {
+
+  FILE* ifh = fopen(queryFile,"r");
+  if (!ifh) {
+    fprintf(stderr,"ERROR (answerQueries): could not open %s\n",queryFile);
+    return(1);
+  }
+
+  // read all of them first, so that they go through in one batch
+  size_t count = 0;
+  size_t room = 1024;
+  float* pos[MAXDIMS] = {NULL, NULL, NULL};
+  float* value = NULL;
+  BOOL failed = FALSE;
+  for (uint8_t d=0; d<MAXDIMS && !failed; d++) {
+    pos[d] = (float*) malloc(room*sizeof(float));
+    if (!pos[d]) failed = TRUE;
+  }
+
+  size_t line = 0;
+  char buf[QUERYMAXLINE+2];
+  while (!failed && fgets(buf, QUERYMAXLINE+2, ifh)) {
+    line++;
+    if (strlen(buf) > QUERYMAXLINE && buf[QUERYMAXLINE] != '\n') {
+      fprintf(stderr,"ERROR (answerQueries): line %zu of %s is too long\n",line,queryFile);
+      fclose(ifh);
+      for (uint8_t d=0; d<MAXDIMS; d++) free(pos[d]);
+      return(1);
+    }
+
+    // exactly one number per dimension, or nothing at all
+    float x[MAXDIMS];
+    char* next = buf;
+    uint8_t d = 0;
+    while (d < g->numDims) {
+      char* end;
+      x[d] = strtof(next, &end);
+      if (end == next) break;
+      next = end;
+      d++;
+    }
+    while (isspace((unsigned char)*next)) next++;
+    if (d == 0 && *next == '\0') continue;
+    if (d < g->numDims || *next != '\0') {
+      fprintf(stderr,"ERROR (answerQueries): line %zu of %s is not %u numbers\n",
+              line,queryFile,g->numDims);
+      fclose(ifh);
+      for (uint8_t k=0; k<MAXDIMS; k++) free(pos[k]);
+      return(1);
+    }
+
+    if (count == room) {
+      room *= 2;
+      for (uint8_t k=0; k<MAXDIMS; k++) {
+        float* grown = (float*) realloc(pos[k], room*sizeof(float));
+        if (!grown) {
+          failed = TRUE;
+          break;
+        }
+        pos[k] = grown;
+      }
+      if (failed) break;
+    }
+    for (uint8_t k=0; k<g->numDims; k++) pos[k][count] = x[k];
+    count++;
+  }
+  if (!failed && ferror(ifh)) {
+    fprintf(stderr,"ERROR (answerQueries): could not read %s\n",queryFile);
+    fclose(ifh);
+    for (uint8_t d=0; d<MAXDIMS; d++) free(pos[d]);
+    return(1);
+  }
+  fclose(ifh);
+
+  if (!failed) {
+    value = (float*) malloc((count+1)*sizeof(float));
+    if (!value) failed = TRUE;
+  }
+  if (failed) {
+    fprintf(stderr,"ERROR (answerQueries): could not allocate %zu points\n",room);
+    for (uint8_t d=0; d<MAXDIMS; d++) free(pos[d]);
+    return(1);
+  }
+
+  sampleGrid(g, kind, count, (const float* const*)pos, value);
+
+  for (size_t i=0; i<count; i++) {
+    for (uint8_t d=0; d<g->numDims; d++) fprintf(stdout,"%g ",pos[d][i]);
+    fprintf(stdout,"%g\n",value[i]);
+  }
+
+  for (uint8_t d=0; d<MAXDIMS; d++) free(pos[d]);
+  free(value);
+  return(0);
+}
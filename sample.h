@@ -0,0 +1,47 @@
+/*
+ * sample.h - part of noisegen
+ *
+ * Values of a periodic noise grid at arbitrary points
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+
+// points handled together, small enough that their taps stay in L1
+#define SAMPLEBLOCK 64
+
+// longest line of a -query file
+#define QUERYMAXLINE 1024
+
+// how to fill in between grid points
+typedef enum interpolationType {linear,cubic} INTERP;
+
+// a generated grid, row-major with the last index fastest, which
+// repeats forever in every direction
+typedef struct noiseGridType {
+  uint8_t numDims;
+  size_t n[MAXDIMS];
+  const float* data;
+} NOISEGRID;
+
+void initGrid (NOISEGRID*, const uint8_t, const size_t*, const float*);
+void sampleGrid (const NOISEGRID*, const INTERP, const size_t, const float* const*, float*);
+int answerQueries (const NOISEGRID*, const INTERP, const char*);
@@ -0,0 +1,408 @@
+/*
+ * server.c - part of noisegen
+ *
+ * Stay up and answer noise requests over a UNIX domain socket, so that
+ * process startup, FFTW planning, and buffer allocation are paid once
+ * instead of once per field. The main thread accepts connections and
+ * queues them; a pool of workers, each with its own library context
+ * and output buffer, takes them off the queue and answers every
+ * request on a connection until the client closes it. The plan cache
+ * is shared by all of them.
+ *
+ * link with -lfftw3f -lpthread
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// sockets and sigaction are POSIX, hidden by -std=c99
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fftw3.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "libnoisegen.h"
+#include "request.h"
+#include "server.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+//
+// Connections waiting for a worker
+//
+typedef struct serveQueueType {
+  int fd[SERVEQUEUE];
+  size_t first;
+  size_t count;
+  BOOL done;
+  // the connection each worker is on, or -1
+  int* active;
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+} SERVEQUEUETYPE;
+
+typedef struct serveWorkerType {
+  SERVEQUEUETYPE* q;
+  int id;
+  int numThreads;
+  pthread_t thread;
+} SERVEWORKER;
+
+// SIGINT or SIGTERM writes to this pipe, which wakes the accept loop
+static int stopPipe[2] = {-1, -1};
+
+static void stopOnSignal (int sig) {
+  (void) sig;
+  const char c = 1;
+  const int saved = errno;
+  (void) write(stopPipe[1], &c, 1);
+  errno = saved;
+}
+
+
+//
+// Queue a new connection; return FALSE if the queue is full, since
+// waiting here would keep the accept loop from seeing a stop
+//
+static BOOL pushConnection (SERVEQUEUETYPE* q, const int fd) {
+  pthread_mutex_lock(&q->lock);
+  const BOOL room = (q->count < SERVEQUEUE);
+  if (room) {
+    q->fd[(q->first + q->count) % SERVEQUEUE] = fd;
+    q->count++;
+    pthread_cond_signal(&q->notEmpty);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return room;
+}
+
+//
+// The next connection for worker id, or -1 once the server is shutting
+// down and the queue is empty; once it is shutting down, the reading
+// side is shut too, so what the client already sent is answered but
+// the worker never waits for more
+//
+static int popConnection (SERVEQUEUETYPE* q, const int id) {
+  pthread_mutex_lock(&q->lock);
+  while (q->count == 0 && !q->done) pthread_cond_wait(&q->notEmpty, &q->lock);
+  int fd = -1;
+  if (q->count > 0) {
+    fd = q->fd[q->first];
+    q->first = (q->first+1) % SERVEQUEUE;
+    q->count--;
+    if (q->done) (void) shutdown(fd, SHUT_RD);
+  }
+  q->active[id] = fd;
+  pthread_mutex_unlock(&q->lock);
+  return fd;
+}
+
+static void closeConnection (SERVEQUEUETYPE* q, const int id, const int fd) {
+  pthread_mutex_lock(&q->lock);
+  q->active[id] = -1;
+  pthread_mutex_unlock(&q->lock);
+  close(fd);
+}
+
+//
+// Stop taking connections, and wake every worker that is waiting on
+// a client for its next request
+//
+static void stopConnections (SERVEQUEUETYPE* q, const int numWorkers) {
+  pthread_mutex_lock(&q->lock);
+  q->done = TRUE;
+  for (int w=0; w<numWorkers; w++) {
+    if (q->active[w] >= 0) (void) shutdown(q->active[w], SHUT_RD);
+  }
+  pthread_cond_broadcast(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+}
+
+
+//
+// Read or write exactly nbytes, return 1 on failure or end of file
+//
+static int readFully (const int fd, void* buf, const size_t nbytes) {
+  size_t done = 0;
+  while (done < nbytes) {
+    const ssize_t got = read(fd, (char*)buf+done, nbytes-done);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return(1);
+    done += (size_t)got;
+  }
+  return(0);
+}
+
+static int writeFully (const int fd, const void* buf, const size_t nbytes) {
+  size_t done = 0;
+  while (done < nbytes) {
+    const ssize_t put = send(fd, (const char*)buf+done, nbytes-done, MSG_NOSIGNAL);
+    if (put < 0 && errno == EINTR) continue;
+    if (put <= 0) return(1);
+    done += (size_t)put;
+  }
+  return(0);
+}
+
+static int sendReply (const int fd, const int32_t status, const uint8_t numDims,
+    const size_t* n, const void* payload, const size_t bytes) {
+  SERVEREPLY r;
+  memset(&r, 0, sizeof(SERVEREPLY));
+  r.status = status;
+  r.numDims = numDims;
+  for (uint8_t d=0; d<numDims; d++) r.n[d] = n[d];
+  r.bytes = bytes;
+  if (writeFully(fd, &r, sizeof(SERVEREPLY))) return(1);
+  return (bytes > 0) ? writeFully(fd, payload, bytes) : 0;
+}
+
+static int sendError (const int fd, const char* why) {
+  fprintf(stderr,"ERROR (serveNoise): %s\n",why);
+  return sendReply(fd, 1, 0, NULL, why, strlen(why));
+}
+
+
+//
+// Answer one request on this connection; return 1 when the client
+// has gone, or is past helping
+//
+static int answerRequest (const int fd, const int numThreads, NGCONTEXT* ctx,
+    float** out, size_t* outSize) {
+
+  uint32_t len = 0;
+  if (readFully(fd, &len, sizeof(uint32_t))) return(1);
+  if (len > SERVEMAXREQUEST) {
+    (void) sendError(fd, "request is too long");
+    return(1);
+  }
+  char request[SERVEMAXREQUEST+1];
+  if (readFully(fd, request, len)) return(1);
+  request[len] = '\0';
+
+  char* argv[MAXREQUESTWORDS];
+  const int argc = splitRequest(request, argv);
+  if (argc < 0) return sendError(fd, "too many words in request");
+
+  NGPARAMS p;
+  PLANE planes[MAXPLANES];
+  uint8_t numDims;
+  char* outfile;
+  char why[256];
+  BOOL switched;
+  if (parseRequest(argc, argv, numThreads, &p, &numDims, planes, &outfile, why, &switched)) {
+    return sendError(fd, why);
+  }
+
+  size_t ntotal = 1;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= p.n[d];
+  if (*outSize < ntotal) {
+    if (*out) fftwf_free(*out);
+    *out = (float*) fftwf_malloc(ntotal*sizeof(float));
+    *outSize = *out ? ntotal : 0;
+    if (!*out) return sendError(fd, "could not allocate the answer");
+  }
+
+  int failed;
+  if (numDims == 1) failed = ng_generate_1d(ctx, &p, *out);
+  else if (numDims == 2) failed = ng_generate_2d(ctx, &p, *out);
+  else failed = ng_generate_3d(ctx, &p, *out);
+  if (failed) return sendError(fd, "could not make the noise");
+
+  // send it back, or write it where asked
+  if (!outfile) {
+    return sendReply(fd, 0, numDims, p.n, *out, ntotal*sizeof(float));
+  }
+  if (writeRequest(numDims, p.n, *out, outfile)) {
+    return sendError(fd, "could not write the output file");
+  }
+  return sendReply(fd, 0, numDims, p.n, NULL, 0);
+}
+
+
+//
+// One worker: its own context and answer buffer, warm for every
+// request it takes
+//
+static void* serveWorker (void* arg) {
+
+  SERVEWORKER* w = (SERVEWORKER*)arg;
+#ifdef _OPENMP
+  // the workers are the parallelism here
+  omp_set_num_threads(1);
+#endif
+  NGCONTEXT* ctx = ng_create();
+  float* out = NULL;
+  size_t outSize = 0;
+
+  while (TRUE) {
+    const int fd = popConnection(w->q, w->id);
+    if (fd < 0) break;
+    while (answerRequest(fd, w->numThreads, ctx, &out, &outSize) == 0) ;
+    closeConnection(w->q, w->id, fd);
+  }
+
+  if (out) fftwf_free(out);
+  ng_destroy(ctx);
+  return NULL;
+}
+
+
+/*
+ * Listen on socketPath and answer requests with numWorkers workers
+ * until SIGINT or SIGTERM
+ */
+int serveNoise (const char* socketPath, const int numWorkers) {
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr,"ERROR (serveNoise): socket path %s is too long\n",socketPath);
+    return(1);
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  // clear out a socket left by an earlier server, but nothing else
+  struct stat st;
+  if (stat(socketPath, &st) == 0 && S_ISSOCK(st.st_mode)) (void) unlink(socketPath);
+
+  // requests can write files anywhere this process can, so only its
+  // own user may connect
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  const mode_t oldUmask = umask(0177);
+  const int bound = (listener >= 0 &&
+      bind(listener, (struct sockaddr*)&addr, sizeof(struct sockaddr_un)) == 0);
+  (void) umask(oldUmask);
+  if (!bound || chmod(socketPath, S_IRUSR | S_IWUSR) != 0 ||
+      listen(listener, SOMAXCONN) != 0) {
+    fprintf(stderr,"ERROR (serveNoise): could not listen on %s\n",socketPath);
+    if (listener >= 0) close(listener);
+    if (bound) (void) unlink(socketPath);
+    return(1);
+  }
+
+  // stop cleanly on a signal, and never die on a closed connection
+  if (pipe(stopPipe) != 0) {
+    fprintf(stderr,"ERROR (serveNoise): could not make the stop pipe\n");
+    close(listener);
+    return(1);
+  }
+  struct sigaction sa, oldInt, oldTerm;
+  memset(&sa, 0, sizeof(struct sigaction));
+  sa.sa_handler = stopOnSignal;
+  sigemptyset(&sa.sa_mask);
+  (void) sigaction(SIGINT, &sa, &oldInt);
+  (void) sigaction(SIGTERM, &sa, &oldTerm);
+  signal(SIGPIPE, SIG_IGN);
+
+  SERVEQUEUETYPE q;
+  q.first = 0;
+  q.count = 0;
+  q.done = FALSE;
+  pthread_mutex_init(&q.lock, NULL);
+  pthread_cond_init(&q.notEmpty, NULL);
+
+  const int nw = (numWorkers > 0) ? numWorkers : 1;
+  SERVEWORKER* workers = (SERVEWORKER*) malloc(nw*sizeof(SERVEWORKER));
+  q.active = (int*) malloc(nw*sizeof(int));
+  for (int w=0; w<nw; w++) q.active[w] = -1;
+
+  // the signals go to this thread only, as the workers start with them
+  // blocked
+  sigset_t stopSignals, oldMask;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, &oldMask);
+  for (int w=0; w<nw; w++) {
+    workers[w].q = &q;
+    workers[w].id = w;
+    workers[w].numThreads = nw;
+    pthread_create(&workers[w].thread, NULL, serveWorker, &workers[w]);
+  }
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+  fprintf(stderr,"Serving on %s with %d workers\n",socketPath,nw);
+  if (nw > 1) noteSwitchedGenerator("2D and 3D requests");
+
+  // wait for a connection or for the stop pipe, so that a signal
+  // arriving between two accepts is never missed
+  struct pollfd pfd[2];
+  pfd[0].fd = listener;
+  pfd[0].events = POLLIN;
+  pfd[1].fd = stopPipe[0];
+  pfd[1].events = POLLIN;
+  while (TRUE) {
+    if (poll(pfd, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr,"ERROR (serveNoise): poll failed\n");
+      break;
+    }
+    if (pfd[1].revents) break;
+    if (!(pfd[0].revents & POLLIN)) continue;
+
+    const int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      fprintf(stderr,"ERROR (serveNoise): accept failed\n");
+      break;
+    }
+    if (!pushConnection(&q, fd)) {
+      (void) sendError(fd, "server is busy");
+      close(fd);
+    }
+  }
+
+  // let the workers finish what they have, then go
+  stopConnections(&q, nw);
+  for (int w=0; w<nw; w++) pthread_join(workers[w].thread, NULL);
+  free(workers);
+  free(q.active);
+
+  close(listener);
+  (void) unlink(socketPath);
+  (void) sigaction(SIGINT, &oldInt, NULL);
+  (void) sigaction(SIGTERM, &oldTerm, NULL);
+  close(stopPipe[0]);
+  close(stopPipe[1]);
+  pthread_mutex_destroy(&q.lock);
+  pthread_cond_destroy(&q.notEmpty);
+  fprintf(stderr,"Stopped serving on %s\n",socketPath);
+
+  return(0);
+}
+
+#else
+
+int serveNoise (const char* socketPath, const int numWorkers) {
+  (void) socketPath;
+  (void) numWorkers;
+  fprintf(stderr,"ERROR (serveNoise): no UNIX domain sockets on this platform\n");
+  return(1);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * server.h - part of noisegen
+ *
+ * Answer noise requests over a UNIX domain socket, with plans and
+ * buffers kept warm between them
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+
+// longest request, and connections waiting for a worker
+#define SERVEMAXREQUEST 4096
+#define SERVEQUEUE 64
+
+// A request is a native-endian uint32_t byte count followed by that
+// many bytes of command-line options, such as "-d 2 -n 256 256 -pink";
+// each is answered with this header and then bytes of payload: the
+// floats themselves, nothing if -o named a file to write, or an error
+// message if status is not 0
+typedef struct serveReplyType {
+  int32_t status;
+  uint32_t numDims;
+  uint64_t n[MAXDIMS];
+  uint64_t bytes;
+} SERVEREPLY;
+
+int serveNoise (const char*, const int);
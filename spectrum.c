@@ -0,0 +1,192 @@
+/*
+ * spectrum.c - part of noisegen
+ *
+ * Save the raw r2c spectrum of the white noise, before any shaping,
+ * and shape it again later straight out of a read-only mapping of the
+ * file, so that a new look costs one shaping pass and one inverse FFT.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// mmap is POSIX, hidden by -std=c99
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fftw3.h>
+#include "filter.h"
+#include "spectrum.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//
+// Bytes of spectrum after the header
+//
+static size_t spectrumBytes (const uint8_t numDims, const size_t* n) {
+  size_t nc = n[numDims-1]/2+1;
+  for (uint8_t d=0; d<numDims-1; d++) nc *= n[d];
+  return nc*sizeof(fftwf_complex);
+}
+
+
+//
+// Read and check the header, which sets the sizes of the run
+//
+int readSpectrumHeader (const char* infile, SPECHEADER* h) {
+
+  FILE* ifh = fopen(infile,"rb");
+  if (!ifh) {
+    fprintf(stderr,"ERROR (readSpectrumHeader): could not open %s\n",infile);
+    return(1);
+  }
+  const size_t got = fread(h,sizeof(SPECHEADER),1,ifh);
+  fclose(ifh);
+
+  if (got != 1 || strncmp(h->magic,SPECTRUMMAGIC,8) != 0) {
+    fprintf(stderr,"ERROR (readSpectrumHeader): %s is not a spectrum file\n",infile);
+    return(1);
+  }
+  if (h->numDims < 2 || h->numDims > MAXDIMS) {
+    fprintf(stderr,"ERROR (readSpectrumHeader): %s holds %u dimensions\n",infile,h->numDims);
+    return(1);
+  }
+
+  // every size must be nonzero, and the points and the padded spectrum
+  // must both be countable in a size_t
+  size_t ntotal = 1;
+  size_t nc = 1;
+  for (uint8_t d=0; d<h->numDims; d++) {
+    const uint64_t nd = h->n[d];
+    const uint64_t ncd = (d == h->numDims-1) ? nd/2+1 : nd;
+    if (nd == 0 || nd > SIZE_MAX/ntotal ||
+        ncd > SIZE_MAX/sizeof(fftwf_complex)/nc) {
+      fprintf(stderr,"ERROR (readSpectrumHeader): %s has bad sizes\n",infile);
+      return(1);
+    }
+    ntotal *= (size_t)nd;
+    nc *= (size_t)ncd;
+  }
+  return(0);
+}
+
+
+/*
+ * Write the header and the unshaped spectrum
+ */
+int saveSpectrum (const char* outfile, const uint8_t numDims, const size_t* n,
+    const int randSeed, const BOOL gaussian, const RNG generator,
+    const BOOL synthesized, const void* data) {
+
+  SPECHEADER h;
+  memset(&h, 0, sizeof(SPECHEADER));
+  memcpy(h.magic, SPECTRUMMAGIC, 8);
+  h.numDims = numDims;
+  h.gaussian = gaussian ? 1 : 0;
+  for (uint8_t d=0; d<MAXDIMS; d++) h.n[d] = (d<numDims) ? n[d] : 1;
+  h.seed = randSeed;
+  h.generator = (uint32_t)generator;
+  h.synthesized = synthesized ? 1 : 0;
+
+  FILE* ofh = fopen(outfile,"wb");
+  if (!ofh) {
+    fprintf(stderr,"ERROR (saveSpectrum): could not open %s\n",outfile);
+    return(1);
+  }
+  const size_t nbytes = spectrumBytes(numDims, n);
+  if (fwrite(&h,sizeof(SPECHEADER),1,ofh) != 1 ||
+      fwrite(data,1,nbytes,ofh) != nbytes) {
+    fprintf(stderr,"ERROR (saveSpectrum): could not write %s\n",outfile);
+    fclose(ofh);
+    return(1);
+  }
+  if (fclose(ofh)) {
+    fprintf(stderr,"ERROR (saveSpectrum): could not write %s\n",outfile);
+    return(1);
+  }
+  return(0);
+}
+
+
+/*
+ * Shape the saved spectrum into out, which must have room for it; the
+ * 1/N of the inverse transform is included, so reproject with 1.0
+ */
+int shapeSavedSpectrum (const char* infile, const uint8_t numDims, const size_t* n,
+    void* out, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp) {
+
+  float ntotal = 1.0;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= (float)n[d];
+
+  // the same filter as a fresh run, or just the scaling if uncolored
+  NOISEFILTER nf;
+  if (colored) {
+    if (makeNoiseFilter(&nf, numDims, n, 1.0/ntotal,
+                        longestWavelength, shortestWavelength, exponent, numPlanes, pp)) {
+      return(1);
+    }
+  } else {
+    initFilter(&nf.filter, numDims, n, 1.0/ntotal);
+  }
+
+  const size_t nbytes = spectrumBytes(numDims, n);
+  const size_t total = sizeof(SPECHEADER) + nbytes;
+  int retval = 0;
+
+#ifndef _WIN32
+  // read straight from the page cache, nothing is copied first
+  int fd = open(infile, O_RDONLY);
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= total) {
+    map = mmap(NULL, total, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  if (map == MAP_FAILED) {
+    fprintf(stderr,"ERROR (shapeSavedSpectrum): could not map %s\n",infile);
+    retval = 1;
+  } else {
+    (void) madvise(map, total, MADV_SEQUENTIAL);
+    retval = applyFilterFrom((const char*)map + sizeof(SPECHEADER), out, &nf.filter);
+    munmap(map, total);
+  }
+  if (fd >= 0) close(fd);
+#else
+  // no mmap here, so read it in and shape it in place
+  FILE* ifh = fopen(infile,"rb");
+  if (!ifh || fseek(ifh, sizeof(SPECHEADER), SEEK_SET) != 0 ||
+      fread(out,1,nbytes,ifh) != nbytes) {
+    fprintf(stderr,"ERROR (shapeSavedSpectrum): could not read %s\n",infile);
+    retval = 1;
+  } else {
+    retval = applyFilter(out, &nf.filter);
+  }
+  if (ifh) fclose(ifh);
+#endif
+
+  if (colored) freeNoiseFilter(&nf);
+  return(retval);
+}
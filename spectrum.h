@@ -0,0 +1,51 @@
+/*
+ * spectrum.h - part of noisegen
+ *
+ * saved white-noise spectra, to re-color without the RNG and forward FFT
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+#include "planes.h"
+#include "rng.hpp"
+
+#define SPECTRUMMAGIC "NGSPEC01"
+
+// 64 bytes, then the r2c spectrum as nrows*(nlast/2+1) complex floats
+typedef struct spectrumHeaderType {
+  char magic[8];
+  uint32_t numDims;
+  // 0 for uniform, 1 for Gaussian
+  uint32_t gaussian;
+  uint64_t n[MAXDIMS];
+  int32_t seed;
+  uint32_t generator;
+  // made directly in frequency space (-spectral)?
+  uint32_t synthesized;
+  uint32_t reserved[3];
+} SPECHEADER;
+
+int readSpectrumHeader (const char*, SPECHEADER*);
+int saveSpectrum (const char*, const uint8_t, const size_t*,
+                  const int, const BOOL, const RNG, const BOOL, const void*);
+int shapeSavedSpectrum (const char*, const uint8_t, const size_t*, void*,
+                        const BOOL, const float, const float, const float,
+                        const uint32_t, const PLANE*);
@@ -0,0 +1,200 @@
+/*
+ * stream1d.c - part of noisegen
+ *
+ * Make 1D colored noise of any length in constant memory. The power
+ * law is turned into a windowed FIR kernel once, then white noise is
+ * filtered through it in fixed blocks with overlap-save FFT
+ * convolution, and each block is written as soon as it is done.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "output1d.h"
+#include "stream1d.h"
+
+#define M_PI 3.14159265358979323846
+
+
+//
+// Turn the power law into a linear-phase FIR kernel of the given
+// length; the gain at bin k of the kernel is (1+k)^exponent, as in
+// shiftSpectrum1D with the kernel length standing in for the record
+// length, and the band-pass wavelengths are in the same units
+//
+static float* makeStreamKernel (const size_t taps, const float exponent,
+    const float longestWavelength, const float shortestWavelength) {
+
+  const size_t nc = taps/2+1;
+  const ptrdiff_t dims[1] = {(ptrdiff_t)taps};
+  fftwf_complex* spec = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+  float* zero = (float*) fftwf_malloc(taps*sizeof(float));
+  if (!spec || !zero) {
+    fprintf(stderr,"ERROR (makeStreamKernel): could not allocate %zu taps\n",taps);
+    if (spec) fftwf_free(spec);
+    if (zero) fftwf_free(zero);
+    return NULL;
+  }
+
+  // a real, zero-phase response
+  for (size_t k=0; k<nc; k++) {
+    const float wavelength = 1.0 / (float)(1+k);
+    BOOL cut = FALSE;
+    if (longestWavelength > 0.0 && wavelength > longestWavelength) cut = TRUE;
+    if (shortestWavelength > 0.0 && wavelength < shortestWavelength) cut = TRUE;
+    spec[k][0] = cut ? 0.0 : pow((float)(1+k), exponent);
+    spec[k][1] = 0.0;
+  }
+  const int failed = executeC2R(1, dims, spec, zero);
+  fftwf_free(spec);
+  if (failed) {
+    fftwf_free(zero);
+    return NULL;
+  }
+
+  // centre it, so that it is causal, and taper the ends
+  float* kernel = (float*) malloc(taps*sizeof(float));
+  if (!kernel) {
+    fprintf(stderr,"ERROR (makeStreamKernel): could not allocate %zu taps\n",taps);
+    fftwf_free(zero);
+    return NULL;
+  }
+  for (size_t j=0; j<taps; j++) {
+    const float window = 0.5 - 0.5*cos(2.0*M_PI*(float)j/(float)taps);
+    kernel[j] = window * zero[(j+taps-taps/2)%taps] / (float)taps;
+  }
+  fftwf_free(zero);
+
+  return kernel;
+}
+
+
+/*
+ * Generate and write total samples of 1D noise, or never stop if total
+ * is zero; every block of output is filtered from the last taps white
+ * samples of history plus block new ones, so the block size changes
+ * nothing but the rounding
+ */
+int makeNoiseStream1D (const size_t total, const size_t block, const size_t taps,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const OUTFF outtype, char* outfile) {
+
+  FILE* ofh = beginData1D(outtype, outfile);
+  if (!ofh) return(1);
+
+  // history and new samples, padded for the in-place transform
+  const size_t hist = colored ? taps : 0;
+  const size_t nfft = hist + block;
+  const size_t nc = nfft/2+1;
+  const ptrdiff_t dims[1] = {(ptrdiff_t)nfft};
+  float* signal = (float*) malloc(nfft*sizeof(float));
+  float* work = (float*) fftwf_malloc(2*nc*sizeof(float));
+  fftwf_complex* cwork = (fftwf_complex*)work;
+  int failed = 0;
+  if (!signal || !work) {
+    fprintf(stderr,"ERROR (makeNoiseStream1D): could not allocate blocks of %zu samples\n",nfft);
+    failed = 1;
+  }
+
+  // the spectrum of the kernel, with the 1/N of the inverse in it
+  fftwf_complex* response = NULL;
+  if (colored && !failed) {
+    float* kernel = makeStreamKernel(taps, exponent, longestWavelength, shortestWavelength);
+    if (kernel) {
+      for (size_t i=0; i<nfft; i++) work[i] = (i < taps) ? kernel[i]/(float)nfft : 0.0;
+      free(kernel);
+      if (executeR2C(1, dims, work, cwork)) {
+        failed = 1;
+      } else {
+        response = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+        if (response) {
+          memcpy(response, cwork, nc*sizeof(fftwf_complex));
+        } else {
+          fprintf(stderr,"ERROR (makeNoiseStream1D): could not allocate the kernel spectrum\n");
+          failed = 1;
+        }
+      }
+    } else {
+      failed = 1;
+    }
+  }
+
+  // white noise is counter-based, so the stream can pick up anywhere
+  size_t next = 0;
+  if (hist > 0 && !failed) {
+    if (gaussian) getRandomGaussianAt(generator,randSeed,next,signal,hist,0.0,1.0);
+    else getRandomUniformAt(generator,randSeed,next,signal,hist,-1.0,1.0);
+    next += hist;
+  }
+
+  for (size_t first=0; !failed && (total == 0 || first < total); first+=block) {
+    const size_t nb = (total > 0 && total-first < block) ? total-first : block;
+
+    if (gaussian) getRandomGaussianAt(generator,randSeed,next,signal+hist,block,0.0,1.0);
+    else getRandomUniformAt(generator,randSeed,next,signal+hist,block,-1.0,1.0);
+    next += block;
+
+    if (colored) {
+      // circular convolution, whose last block samples are the linear one
+      memcpy(work, signal, nfft*sizeof(float));
+      if (executeR2C(1, dims, work, cwork)) {
+        failed = 1;
+        break;
+      }
+      for (size_t k=0; k<nc; k++) {
+        const float re = cwork[k][0]*response[k][0] - cwork[k][1]*response[k][1];
+        const float im = cwork[k][0]*response[k][1] + cwork[k][1]*response[k][0];
+        cwork[k][0] = re;
+        cwork[k][1] = im;
+      }
+      if (executeC2R(1, dims, cwork, work)) {
+        failed = 1;
+        break;
+      }
+      if (writeBlock1D(outtype, ofh, work+hist, first, nb, 1)) {
+        failed = 1;
+        break;
+      }
+
+      // keep the newest taps samples as the next history
+      memmove(signal, signal+block, hist*sizeof(float));
+    } else {
+      if (writeBlock1D(outtype, ofh, signal, first, nb, 1)) {
+        failed = 1;
+        break;
+      }
+    }
+  }
+
+  if (endData1D(ofh, outfile)) failed = 1;
+  if (response) fftwf_free(response);
+  if (work) fftwf_free(work);
+  free(signal);
+
+  return(failed);
+}
@@ -0,0 +1,121 @@
+/*
+ * testphilox.c - part of noisegen
+ *
+ * Check the Philox4x32-10 stream: a plain reference implementation must
+ * give the published known-answer vectors, and the batched generator in
+ * rng.cpp must give the reference's words for several seeds, whether
+ * the stream is made in one piece or started at an offset.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "rng.hpp"
+
+#define NSAMPLES 1000
+
+//
+// One Philox4x32-10 block, one round at a time
+//
+static void philoxReference (const uint32_t* ctr, const uint32_t* key, uint32_t* out) {
+  uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+  uint32_t k0 = key[0];
+  uint32_t k1 = key[1];
+  for (int r=0; r<10; r++) {
+    const uint64_t p0 = (uint64_t)0xD2511F53 * c[0];
+    const uint64_t p1 = (uint64_t)0xCD9E8D57 * c[2];
+    c[0] = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+    c[1] = (uint32_t)p1;
+    c[2] = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+    c[3] = (uint32_t)p0;
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+  for (int i=0; i<4; i++) out[i] = c[i];
+}
+
+//
+// The uniform sample in [0,1) that rng.cpp makes from word w
+//
+static float wordToUniform (const uint32_t w) {
+  const float unit = 1.0f * (1.0f/16777216.0f);
+  return 0.0f + unit*((float)(w >> 8) + 0.5f);
+}
+
+int main (int argc, char** argv) {
+
+  int failed = 0;
+
+  // the known-answer vectors of Salmon et al., counter then key
+  const uint32_t kat[3][10] = {
+    {0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+     0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+    {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+     0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+    {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+     0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (int v=0; v<3; v++) {
+    uint32_t out[4];
+    philoxReference(kat[v], kat[v]+4, out);
+    for (int i=0; i<4; i++) {
+      if (out[i] != kat[v][6+i]) {
+        fprintf(stderr,"FAILED: vector %d word %d is %08x, not %08x\n",v,i,out[i],kat[v][6+i]);
+        failed = 1;
+      }
+    }
+  }
+
+  // sample i is word i%4 of block i/4, keyed by the seed
+  const int seeds[4] = {0, 1, -1, 12345};
+  float* all = (float*) malloc(NSAMPLES*sizeof(float));
+  float* part = (float*) malloc(NSAMPLES*sizeof(float));
+  for (int s=0; s<4; s++) {
+    getRandomUniform(philox, seeds[s], all, NSAMPLES, 0.0, 1.0);
+    const uint32_t key[2] = {(uint32_t)seeds[s], 0};
+    for (size_t b=0; b<NSAMPLES/4; b++) {
+      const uint32_t ctr[4] = {(uint32_t)b, (uint32_t)((uint64_t)b >> 32), 0, 0};
+      uint32_t w[4];
+      philoxReference(ctr, key, w);
+      for (int i=0; i<4; i++) {
+        if (all[4*b+i] != wordToUniform(w[i])) {
+          fprintf(stderr,"FAILED: seed %d sample %zu is %.9g, not %.9g\n",
+                  seeds[s],4*b+i,all[4*b+i],wordToUniform(w[i]));
+          failed = 1;
+        }
+      }
+    }
+
+    // any piece of the stream matches the whole of it
+    const size_t offset = 37;
+    const size_t count = 3*64+5;
+    getRandomUniformAt(philox, seeds[s], offset, part, count, 0.0, 1.0);
+    for (size_t i=0; i<count; i++) {
+      if (part[i] != all[offset+i]) {
+        fprintf(stderr,"FAILED: seed %d sample %zu differs when started at %zu\n",
+                seeds[s],offset+i,offset);
+        failed = 1;
+      }
+    }
+  }
+  free(all);
+  free(part);
+
+  if (!failed) fprintf(stdout,"Philox stream matches the known answers\n");
+  return failed;
+}
@@ -0,0 +1,115 @@
+/*
+ * testsample.c - part of noisegen
+ *
+ * Check the grid sampler: both kinds of interpolation must hit the grid
+ * values exactly at the grid points, in any period, linear must give
+ * the mean halfway between two points, and the cubic must follow a
+ * linear ramp away from the wrap, over more than one block of points.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "rng.hpp"
+#include "sample.h"
+
+int main (int argc, char** argv) {
+
+  int failed = 0;
+
+  // a 2D grid of noise, sampled at every point, shifted by whole periods
+  const size_t n2[MAXDIMS] = {8, 6, 1};
+  float data2[8*6];
+  getRandomUniform(philox, 5, data2, 8*6, -1.0, 1.0);
+  NOISEGRID g;
+  initGrid(&g, 2, n2, data2);
+
+  float x[3*8*6], y[3*8*6], value[3*8*6];
+  size_t count = 0;
+  for (int shift=-1; shift<=1; shift++) {
+    for (size_t i=0; i<8; i++) {
+      for (size_t j=0; j<6; j++) {
+        x[count] = (float)i + (float)(8*shift);
+        y[count] = (float)j - (float)(6*shift);
+        count++;
+      }
+    }
+  }
+  const float* pos[MAXDIMS] = {x, y, NULL};
+  for (int kind=0; kind<2; kind++) {
+    sampleGrid(&g, kind == 0 ? linear : cubic, count, pos, value);
+    for (size_t p=0; p<count; p++) {
+      if (value[p] != data2[p%48]) {
+        fprintf(stderr,"FAILED: %s sample at (%g,%g) is %g, not %g\n",
+                kind == 0 ? "linear" : "cubic",x[p],y[p],value[p],data2[p%48]);
+        failed = 1;
+      }
+    }
+  }
+
+  // halfway along the first axis, including across the wrap
+  count = 0;
+  for (size_t i=0; i<8; i++) {
+    for (size_t j=0; j<6; j++) {
+      x[count] = (float)i + 0.5;
+      y[count] = (float)j;
+      count++;
+    }
+  }
+  sampleGrid(&g, linear, count, pos, value);
+  for (size_t p=0; p<count; p++) {
+    const size_t i = p/6;
+    const size_t j = p%6;
+    const float mean = 0.5*(data2[i*6+j] + data2[((i+1)%8)*6+j]);
+    if (fabs(value[p] - mean) > 1.e-6) {
+      fprintf(stderr,"FAILED: linear sample at (%g,%g) is %g, not %g\n",x[p],y[p],value[p],mean);
+      failed = 1;
+    }
+  }
+
+  // a ramp in 3D, where the cubic taps never reach the wrap
+  const size_t n3[MAXDIMS] = {8, 8, 8};
+  float data3[8*8*8];
+  for (size_t i=0; i<8; i++) {
+    for (size_t j=0; j<8; j++) {
+      for (size_t k=0; k<8; k++) {
+        data3[(i*8+j)*8+k] = 0.5*i - 0.25*j + 0.125*k;
+      }
+    }
+  }
+  initGrid(&g, 3, n3, data3);
+  const size_t npts = 150;
+  float px[150], py[150], pz[150], v3[150];
+  getRandomUniform(philox, 6, px, npts, 1.0, 5.0);
+  getRandomUniform(philox, 7, py, npts, 1.0, 5.0);
+  getRandomUniform(philox, 8, pz, npts, 1.0, 5.0);
+  const float* pos3[MAXDIMS] = {px, py, pz};
+  sampleGrid(&g, cubic, npts, pos3, v3);
+  for (size_t p=0; p<npts; p++) {
+    const float ramp = 0.5*px[p] - 0.25*py[p] + 0.125*pz[p];
+    if (fabs(v3[p] - ramp) > 1.e-5) {
+      fprintf(stderr,"FAILED: cubic sample at (%g,%g,%g) is %g, not %g\n",
+              px[p],py[p],pz[p],v3[p],ramp);
+      failed = 1;
+    }
+  }
+
+  if (!failed) fprintf(stdout,"Grid samples match\n");
+  return failed;
+}
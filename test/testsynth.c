@@ -0,0 +1,134 @@
+/*
+ * testsynth.c - part of noisegen
+ *
+ * Check that spectral synthesis makes Hermitian spectra: the bins that
+ * hold both k and -k must be conjugates of their mirrors, and the
+ * self-conjugate ones real, for even and odd sizes, so that a round
+ * trip through the real transforms gives the spectrum back.
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+
+//
+// Every bin in the planes that are their own mirror along the last
+// axis must be the conjugate of its mirror in the other axes
+//
+static int checkHermitian (const uint8_t numDims, const size_t* n, const fftwf_complex* data) {
+
+  const size_t nlast = n[numDims-1];
+  const size_t nlc = nlast/2+1;
+  const size_t nx = n[0];
+  const size_t ny = (numDims == 3) ? n[1] : 1;
+  const size_t nplanes = (nlast%2 == 0 && nlast > 1) ? 2 : 1;
+
+  for (size_t c=0; c<nplanes; c++) {
+    const size_t k = c*(nlast/2);
+    for (size_t i=0; i<nx; i++) {
+      for (size_t j=0; j<ny; j++) {
+        const size_t mi = (nx-i)%nx;
+        const size_t mj = (ny-j)%ny;
+        const fftwf_complex* a = &data[(i*ny + j)*nlc + k];
+        const fftwf_complex* b = &data[(mi*ny + mj)*nlc + k];
+        if ((*a)[0] != (*b)[0] || (*a)[1] != -(*b)[1]) {
+          fprintf(stderr,"FAILED: %zu",n[0]);
+          for (uint8_t d=1; d<numDims; d++) fprintf(stderr," by %zu",n[d]);
+          fprintf(stderr," bin (%zu,%zu,%zu) is not Hermitian\n",i,j,k);
+          return(1);
+        }
+      }
+    }
+  }
+  return(0);
+}
+
+//
+// Back to real space and forward again must give N times the spectrum
+//
+static int checkRoundTrip (const uint8_t numDims, const size_t* n, const fftwf_complex* data) {
+
+  size_t ntotal = 1;
+  for (uint8_t d=0; d<numDims; d++) ntotal *= n[d];
+  const size_t nc = ntotal / n[numDims-1] * (n[numDims-1]/2+1);
+  const ptrdiff_t dims[MAXDIMS] = {(ptrdiff_t)n[0], (ptrdiff_t)n[1], (ptrdiff_t)n[2]};
+
+  fftwf_complex* spec = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+  fftwf_complex* back = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+  float* real = (float*) fftwf_malloc(ntotal*sizeof(float));
+  memcpy(spec, data, nc*sizeof(fftwf_complex));
+
+  int failed = 0;
+  if (executeC2R(numDims, dims, spec, real) || executeR2C(numDims, dims, real, back)) {
+    fprintf(stderr,"FAILED: could not transform\n");
+    failed = 1;
+  }
+
+  float biggest = 0.0;
+  for (size_t b=0; b<nc; b++) {
+    biggest = fmaxf(biggest, fabs(data[b][0]));
+    biggest = fmaxf(biggest, fabs(data[b][1]));
+  }
+  const float tol = 1.e-4 * biggest * (float)ntotal;
+  for (size_t b=0; b<nc && !failed; b++) {
+    if (fabs(back[b][0] - (float)ntotal*data[b][0]) > tol ||
+        fabs(back[b][1] - (float)ntotal*data[b][1]) > tol) {
+      fprintf(stderr,"FAILED: bin %zu does not survive the round trip\n",b);
+      failed = 1;
+    }
+  }
+
+  fftwf_free(spec);
+  fftwf_free(back);
+  fftwf_free(real);
+  return failed;
+}
+
+int main (int argc, char** argv) {
+
+  int failed = 0;
+
+  const size_t sizes2[6][2] = {{8,8}, {7,6}, {6,5}, {5,7}, {1,4}, {9,1}};
+  for (int s=0; s<6; s++) {
+    const size_t n[MAXDIMS] = {sizes2[s][0], sizes2[s][1], 1};
+    float* out = (float*) fftwf_malloc(2*n[0]*(n[1]/2+1)*sizeof(float));
+    synthesize2D(out, philox, 11+s, n[0], n[1], 1.0);
+    if (checkHermitian(2, n, (fftwf_complex*)out) ||
+        checkRoundTrip(2, n, (fftwf_complex*)out)) failed = 1;
+    fftwf_free(out);
+  }
+
+  const size_t sizes3[5][3] = {{4,6,8}, {5,3,4}, {4,4,5}, {3,5,7}, {2,1,6}};
+  for (int s=0; s<5; s++) {
+    const size_t n[MAXDIMS] = {sizes3[s][0], sizes3[s][1], sizes3[s][2]};
+    float* out = (float*) fftwf_malloc(2*n[0]*n[1]*(n[2]/2+1)*sizeof(float));
+    synthesize3D(out, mersenne, 23+s, n[0], n[1], n[2], 1.0/sqrt(3.0));
+    if (checkHermitian(3, n, (fftwf_complex*)out) ||
+        checkRoundTrip(3, n, (fftwf_complex*)out)) failed = 1;
+    fftwf_free(out);
+  }
+
+  clearPlanCache();
+  if (!failed) fprintf(stdout,"Synthesized spectra are Hermitian\n");
+  return failed;
+}
@@ -0,0 +1,241 @@
+/*
+ * tile2d.c - part of noisegen
+ *
+ * Make any rectangle of an endless 2D colored noise field without
+ * making the rest of it. The white noise under the field is counter-
+ * based and keyed by world coordinates, and the coloring is a windowed
+ * FIR kernel made once from the noise filter, so each output point
+ * depends only on the white noise within half a kernel of it. Tiles
+ * then join without seams, may be made in any order, and cost only
+ * their own size plus the kernel's reach.
+ *
+ * link with -lfftw3f
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#include "fft.h"
+#include "fftplan.h"
+#include "filter.h"
+#include "output2d.h"
+#include "tile2d.h"
+
+#define M_PI 3.14159265358979323846
+
+
+//
+// White noise of the world from (x,y) on, nx rows of ny; each value
+// depends only on the seed and its coordinates, which wrap around at
+// 2^32 in each direction
+//
+static void fillWorld (const RNG generator, const int randSeed, const BOOL gaussian,
+    const int64_t x, const int64_t y, float* out, const size_t nx, const size_t ny) {
+
+  #pragma omp parallel for schedule(static)
+  for (size_t i=0; i<nx; i++) {
+    const uint64_t row = (uint64_t)(uint32_t)(x + (int64_t)i) << 32;
+    size_t j = 0;
+    while (j < ny) {
+      // one call per run of counters, split where the row wraps
+      const uint32_t col = (uint32_t)(y + (int64_t)j);
+      size_t len = ny - j;
+      if ((uint64_t)col + len > ((uint64_t)1 << 32)) len = ((uint64_t)1 << 32) - col;
+      if (gaussian) {
+        getRandomGaussianAt(generator,randSeed,row|col,out+i*ny+j,len,0.0,1.0);
+      } else {
+        getRandomUniformAt(generator,randSeed,row|col,out+i*ny+j,len,-1.0,1.0);
+      }
+      j += len;
+    }
+  }
+}
+
+
+//
+// Turn the noise filter into a windowed FIR kernel of taps by taps,
+// centred at (taps/2,taps/2); without the window it would be exactly
+// the coloring of a periodic still run of that size, 1/N included
+//
+static float* makeTileKernel (const size_t taps,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp) {
+
+  const size_t tn[2] = {taps, taps};
+  const size_t nc = taps*(taps/2+1);
+  const ptrdiff_t dims[2] = {(ptrdiff_t)taps, (ptrdiff_t)taps};
+  float* zero = (float*) fftwf_malloc(2*nc*sizeof(float));
+  float* window = (float*) malloc(taps*sizeof(float));
+  float* kernel = (float*) malloc(taps*taps*sizeof(float));
+  if (!zero || !window || !kernel) {
+    fprintf(stderr,"ERROR (makeTileKernel): could not allocate the kernel\n");
+    if (zero) fftwf_free(zero);
+    if (window) free(window);
+    if (kernel) free(kernel);
+    return NULL;
+  }
+  fftwf_complex* spec = (fftwf_complex*)zero;
+
+  // the filter's gain alone, as a real, zero-phase response
+  for (size_t k=0; k<nc; k++) {
+    spec[k][0] = 1.0;
+    spec[k][1] = 0.0;
+  }
+  NOISEFILTER nf;
+  if (makeNoiseFilter(&nf, 2, tn, 1.0/((float)taps*(float)taps),
+                      longestWavelength, shortestWavelength, exponent, numPlanes, pp)) {
+    fftwf_free(zero);
+    free(window);
+    free(kernel);
+    return NULL;
+  }
+  const int noFilter = applyFilter(spec, &nf.filter);
+  freeNoiseFilter(&nf);
+  if (noFilter || executeC2R(2, dims, spec, zero)) {
+    fftwf_free(zero);
+    free(window);
+    free(kernel);
+    return NULL;
+  }
+  unpadRealArray(zero, taps, taps, 1.0);
+
+  // centre it and taper it to zero at the edges
+  for (size_t j=0; j<taps; j++) {
+    window[j] = 0.5 - 0.5*cos(2.0*M_PI*(float)j/(float)taps);
+  }
+  for (size_t i=0; i<taps; i++) {
+    const size_t si = (i+taps-taps/2)%taps;
+    for (size_t j=0; j<taps; j++) {
+      const size_t sj = (j+taps-taps/2)%taps;
+      kernel[i*taps+j] = window[i]*window[j]*zero[si*taps+sj];
+    }
+  }
+  free(window);
+  fftwf_free(zero);
+
+  return kernel;
+}
+
+
+//
+// Color the tile at origin with one FFT convolution over it and its
+// apron of taps-1 points; work holds p[0] padded rows of the apron and
+// response its spectrum, return 1 if a transform cannot be made
+//
+static int colorTile (const int64_t* origin, const size_t* n, const size_t taps,
+    const RNG generator, const int randSeed, const BOOL gaussian,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const size_t* p, float* work, fftwf_complex* response, float* data) {
+
+  const size_t prow = 2*(p[1]/2+1);
+  const size_t nc = p[0]*(p[1]/2+1);
+  const ptrdiff_t dims[2] = {(ptrdiff_t)p[0], (ptrdiff_t)p[1]};
+  fftwf_complex* cwork = (fftwf_complex*)work;
+
+  // the spectrum of the kernel, with the 1/N of the inverse in it
+  float* kernel = makeTileKernel(taps, longestWavelength, shortestWavelength, exponent,
+                                 numPlanes, pp);
+  if (!kernel) return(1);
+  const float pscale = 1.0/((float)p[0]*(float)p[1]);
+  memset(work, 0, p[0]*prow*sizeof(float));
+  for (size_t i=0; i<taps; i++) {
+    for (size_t j=0; j<taps; j++) {
+      work[i*prow+j] = pscale*kernel[i*taps+j];
+    }
+  }
+  free(kernel);
+  if (executeR2C(2, dims, work, cwork)) return(1);
+  memcpy(response, cwork, nc*sizeof(fftwf_complex));
+
+  // white noise as far out as the kernel reaches, circularly convolved;
+  // the last n of each axis are the linear convolution, with the centre
+  // of the kernel over each point of the tile
+  const int64_t reach = (int64_t)(taps-1-taps/2);
+  fillWorld(generator, randSeed, gaussian, origin[0]-reach, origin[1]-reach,
+            work, p[0], p[1]);
+  padRealArray(work, p[0], p[1]);
+  if (executeR2C(2, dims, work, cwork)) return(1);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t k=0; k<nc; k++) {
+    const float re = cwork[k][0]*response[k][0] - cwork[k][1]*response[k][1];
+    const float im = cwork[k][0]*response[k][1] + cwork[k][1]*response[k][0];
+    cwork[k][0] = re;
+    cwork[k][1] = im;
+  }
+  if (executeC2R(2, dims, cwork, work)) return(1);
+
+  for (size_t i=0; i<n[0]; i++) {
+    memcpy(data + i*n[1], work + (i+taps-1)*prow + (taps-1), n[1]*sizeof(float));
+  }
+  return(0);
+}
+
+
+/*
+ * Make and write the n[0] by n[1] tile of the world whose first point
+ * is at origin; white noise is filtered through the kernel with one
+ * FFT convolution over the tile and its apron
+ */
+int makeNoiseTile2D (const int64_t* origin, const size_t* n, const size_t taps,
+    const RNG generator, const int randSeed,
+    const BOOL gaussian, const BOOL colored,
+    const float longestWavelength, const float shortestWavelength,
+    const float exponent,
+    const uint32_t numPlanes, const PLANE* pp,
+    const OUTFF outtype, char* outfile) {
+
+  float* data = (float*) malloc(n[0]*n[1]*sizeof(float));
+  if (!data) {
+    fprintf(stderr,"ERROR (makeNoiseTile2D): could not allocate the tile\n");
+    return(1);
+  }
+
+  int failed = 0;
+  if (colored) {
+    // the tile and its apron, padded for the in-place transforms
+    const size_t p[2] = {n[0]+taps-1, n[1]+taps-1};
+    const size_t prow = 2*(p[1]/2+1);
+    const size_t nc = p[0]*(p[1]/2+1);
+    float* work = (float*) fftwf_malloc(p[0]*prow*sizeof(float));
+    fftwf_complex* response = (fftwf_complex*) fftwf_malloc(nc*sizeof(fftwf_complex));
+    if (!work || !response) {
+      fprintf(stderr,"ERROR (makeNoiseTile2D): could not allocate the apron\n");
+      failed = 1;
+    } else {
+      failed = colorTile(origin, n, taps, generator, randSeed, gaussian,
+                         longestWavelength, shortestWavelength, exponent, numPlanes, pp,
+                         p, work, response, data);
+    }
+    if (work) fftwf_free(work);
+    if (response) fftwf_free(response);
+  } else {
+    fillWorld(generator, randSeed, gaussian, origin[0], origin[1], data, n[0], n[1]);
+  }
+
+  if (!failed) failed = writeData2D(outtype, outfile, data, n[0], n[1]);
+  free(data);
+
+  return(failed);
+}
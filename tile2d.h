@@ -0,0 +1,38 @@
+/*
+ * tile2d.h - part of noisegen
+ *
+ * Any tile of an endless 2-D noise field, made on its own
+ *
+ *  This file is part of NoiseGen.
+ *  Copyright 2012,5 Mark J. Stock and James Sussino
+ *
+ *  NoiseGen is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NoiseGen is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NoiseGen.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "noisegen.h"
+#include "output.h"
+#include "planes.h"
+#include "rng.hpp"
+
+// default width of the square FIR kernel
+#define TILETAPS 256
+
+int makeNoiseTile2D (const int64_t*, const size_t*, const size_t,
+                     const RNG, const int, const BOOL, const BOOL,
+                     const float, const float, const float,
+                     const uint32_t, const PLANE*,
+                     const OUTFF, char*);